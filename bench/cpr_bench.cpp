@@ -0,0 +1,377 @@
+// Microbenchmarks for the CPR metrics hot path.
+//
+// Native (Linux, against bench/shim/Arduino.h):
+//   pio run -e native_bench && .pio/build/native_bench/program [recording.csv ...]
+// or without PlatformIO:
+//   g++ -std=gnu++11 -O2 -Ibench/shim -Isrc -o cpr_bench bench/cpr_bench.cpp
+//       src/CPRMetricsCalculator.cpp src/PeakDetector.cpp src/AutocorrelationRateEstimator.cpp
+//       src/MultiChannelCPRCalculator.cpp
+//
+// On target (ESP32, timed with the Xtensa CCOUNT register):
+//   pio run -e esp32dev_bench -t upload -t monitor
+// The first *.csv on SPIFFS (written by writeCSVData) is used as the recorded waveform.
+//
+// Every row reports ns per call, CPU cycles per call (target only) and heap
+// allocations per call, taking the best of several runs. Paste before/after
+// tables from this suite into every change that touches the algorithm.
+
+#include <Arduino.h>
+#include <stdlib.h>
+#include <vector>
+#include "CPRMetricsCalculator.h"
+#include "FixedCPRMetricsCalculator.h"
+#include "MultiChannelCPRCalculator.h"
+#include "waveforms.h"
+
+#ifdef ARDUINO
+#include <SPIFFS.h>
+#define BENCH_PRINTF(...) Serial.printf(__VA_ARGS__)
+#else
+HardwareSerialShim Serial;
+#define BENCH_PRINTF(...) printf(__VA_ARGS__)
+#endif
+
+// =============================================
+// ALLOCATION COUNTING AND TIMING
+// =============================================
+
+static volatile uint32_t g_allocations = 0;
+
+void* operator new(size_t size) {
+    g_allocations++;
+    void* ptr = malloc(size);
+    if (ptr == nullptr) {
+        abort();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    g_allocations++;
+    void* ptr = malloc(size);
+    if (ptr == nullptr) {
+        abort();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+
+namespace {
+
+#ifdef ARDUINO
+// CCOUNT wraps after ~17 s at 240 MHz; every timed run is far shorter
+typedef uint32_t Ticks;
+inline Ticks ticksNow() { return ESP.getCycleCount(); }
+inline double ticksToNs(double ticks) { return ticks * 1000.0 / ESP.getCpuFreqMHz(); }
+inline double ticksToCycles(double ticks) { return ticks; }
+const bool HAS_CYCLES = true;
+const int REPEATS = 3;
+#else
+typedef uint64_t Ticks;
+inline Ticks ticksNow() {
+    return (Ticks)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+inline double ticksToNs(double ticks) { return ticks; }
+inline double ticksToCycles(double) { return 0; }
+const bool HAS_CYCLES = false;   // Not measured on the host
+const int REPEATS = 7;
+#endif
+
+struct BenchResult {
+    double ticksPerCall = 0;
+    double allocationsPerCall = 0;
+    size_t calls = 0;
+};
+
+void printHeader() {
+    BENCH_PRINTF("\n%-30s %-18s %9s %10s %10s %9s\n", "benchmark", "waveform", "calls", "ns/call", "cyc/call", "alloc/call");
+    BENCH_PRINTF("%-30s %-18s %9s %10s %10s %9s\n", "---------", "--------", "-----", "-------", "--------", "----------");
+}
+
+void printResult(const char* name, const char* waveform, const BenchResult& result) {
+    char cycles[16] = "-";
+    if (HAS_CYCLES) {
+        snprintf(cycles, sizeof(cycles), "%.1f", ticksToCycles(result.ticksPerCall));
+    }
+    BENCH_PRINTF("%-30s %-18s %9u %10.1f %10s %9.3f\n", name, waveform, (unsigned)result.calls,
+                 ticksToNs(result.ticksPerCall), cycles, result.allocationsPerCall);
+}
+
+// Runs body() REPEATS times; body returns the number of calls it made.
+// Keeps the fastest run, and the allocation count of that run.
+template <typename Body>
+BenchResult measure(Body body) {
+    BenchResult best;
+    for (int r = 0; r < REPEATS; r++) {
+        uint32_t allocationsBefore = g_allocations;
+        Ticks start = ticksNow();
+        size_t calls = body();
+        Ticks elapsed = ticksNow() - start;
+        uint32_t allocations = g_allocations - allocationsBefore;
+
+        if (calls == 0) {
+            continue;
+        }
+        double perCall = (double)elapsed / calls;
+        if (best.calls == 0 || perCall < best.ticksPerCall) {
+            best.ticksPerCall = perCall;
+            best.allocationsPerCall = (double)allocations / calls;
+            best.calls = calls;
+        }
+#ifdef ARDUINO
+        yield();
+#endif
+    }
+    return best;
+}
+
+// =============================================
+// BENCHMARKS
+// =============================================
+
+const size_t BLOCK = 64;
+
+void benchWaveform(const Waveform& wave) {
+    const size_t n = wave.samples.size();
+    if (n == 0) {
+        return;
+    }
+    const uint16_t* samples = wave.samples.data();
+    const uint32_t* timestamps = wave.timestamps.data();
+
+    {
+        CPRMetricsCalculator calculator;
+        printResult("detectTrend", wave.name, measure([&]() {
+            calculator.reset();
+            for (size_t i = 0; i < n; i++) {
+                setMillis(timestamps[i]);
+                calculator.detectTrend(samples[i]);
+            }
+            return n;
+        }));
+
+        printResult("detectTrendBatch/64", wave.name, measure([&]() {
+            calculator.reset();
+            CPRTransition transitions[BLOCK];
+            for (size_t i = 0; i < n; i += BLOCK) {
+                size_t count = min(BLOCK, n - i);
+                calculator.detectTrendBatch(samples + i, timestamps + i, count, nullptr, transitions, BLOCK);
+            }
+            return n;
+        }));
+
+        CPRThresholds zeroCrossing;
+        zeroCrossing.detectorMode = CPRDetectorMode::ZeroCrossing;
+        calculator.updateParams(zeroCrossing);
+        printResult("detectTrendBatch/64 zero-x", wave.name, measure([&]() {
+            calculator.reset();
+            for (size_t i = 0; i < n; i += BLOCK) {
+                size_t count = min(BLOCK, n - i);
+                calculator.detectTrendBatch(samples + i, timestamps + i, count);
+            }
+            return n;
+        }));
+        
+        CPRThresholds autocorrelation;
+        autocorrelation.rateSource = CPRRateSource::Autocorrelation;
+        calculator.updateParams(autocorrelation);
+        printResult("detectTrendBatch/64 autocorr", wave.name, measure([&]() {
+            calculator.reset();
+            for (size_t i = 0; i < n; i += BLOCK) {
+                size_t count = min(BLOCK, n - i);
+                calculator.detectTrendBatch(samples + i, timestamps + i, count);
+            }
+            return n;
+        }));
+    }
+
+    {
+        FixedCPRMetricsCalculator<DefaultCPRConfig> fixed;
+        printResult("fixed detectTrendBatch/64", wave.name, measure([&]() {
+            fixed.reset();
+            CPRTransition transitions[BLOCK];
+            for (size_t i = 0; i < n; i += BLOCK) {
+                size_t count = min(BLOCK, n - i);
+                fixed.detectTrendBatch(samples + i, timestamps + i, count, nullptr, transitions, BLOCK);
+            }
+            return n;
+        }));
+    }
+
+    {
+        // Eight channels fed the same waveform with per-channel offsets
+        static MultiChannelCPRCalculator multi;
+        multi.configure(MultiChannelCPRCalculator::MAX_CHANNELS);
+        printResult("multi-channel x8 (per ch)", wave.name, measure([&]() {
+            multi.reset();
+            uint16_t tick[MultiChannelCPRCalculator::MAX_CHANNELS];
+            for (size_t i = 0; i < n; i++) {
+                for (size_t ch = 0; ch < MultiChannelCPRCalculator::MAX_CHANNELS; ch++) {
+                    tick[ch] = (uint16_t)min(samples[i] + (unsigned)ch * 4, 1023u);
+                }
+                multi.process(tick, timestamps[i]);
+            }
+            return n * MultiChannelCPRCalculator::MAX_CHANNELS;
+        }));
+    }
+}
+
+void benchHighRate(const Waveform& wave) {
+    CPRThresholds params;
+    params.sampleRateHz = 1000;
+    CPRMetricsCalculator calculator;
+    calculator.updateParams(params);
+
+    const size_t n = wave.samples.size();
+    printResult("detectTrendHighRate 1kHz", wave.name, measure([&]() {
+        calculator.reset();
+        CPRSnapshot snapshot;
+        for (size_t i = 0; i < n; i++) {
+            calculator.detectTrendHighRate(wave.samples[i], wave.timestamps[i], snapshot);
+        }
+        return n;
+    }));
+}
+
+} // namespace
+
+// Per-transition steps, timed in isolation on a calculator that has already
+// seen a full session (friend of CPRMetricsCalculator)
+struct CPRMetricsBench {
+    static void run(const Waveform& primer) {
+        CPRMetricsCalculator calculator;
+        calculator.detectTrendBatch(primer.samples.data(), primer.timestamps.data(), primer.samples.size());
+        const size_t calls = 20000;
+
+        printResult("endState (compression+recoil)", primer.name, measure([&]() {
+            for (size_t i = 0; i < calls / 2; i++) {
+                calculator.state = CPRState::Compression;
+                calculator.currentCompressionPeak = 760 + (i & 63);
+                calculator.endState();
+                calculator.state = CPRState::Recoil;
+                calculator.currentRecoilMin = 150 + (i & 63);
+                calculator.endState();
+            }
+            return calls;
+        }));
+
+        printResult("updateRate", primer.name, measure([&]() {
+            for (size_t i = 0; i < calls; i++) {
+                calculator.compressionIntervals.push(500 + (i & 127));
+                calculator.updateRate(1000 + i * 500);
+            }
+            return calls;
+        }));
+
+        printResult("generateAlerts", primer.name, measure([&]() {
+            for (size_t i = 0; i < calls; i++) {
+                calculator.generateAlerts();
+            }
+            return calls;
+        }));
+
+        printResult("getStatus", primer.name, measure([&]() {
+            volatile float sink = 0;   // Keeps the calls from being optimised away
+            for (size_t i = 0; i < calls; i++) {
+                sink = calculator.getStatus().peaks.average;
+            }
+            (void)sink;
+            return calls;
+        }));
+    }
+};
+
+namespace {
+
+void runSuite(std::vector<Waveform>& recorded) {
+    std::vector<Waveform> waves;
+    waves.push_back(synthesize("steady-110", 40, 300, 110, 150, 800, 5));
+    waves.push_back(synthesize("fast-shallow-140", 40, 300, 140, 200, 650, 5));
+    waves.push_back(synthesize("noisy-100", 40, 300, 100, 150, 850, 40));
+    waves.push_back(synthesize("pauses-30s", 40, 300, 110, 150, 800, 5, 30, 5));
+
+    printHeader();
+    for (size_t w = 0; w < waves.size(); w++) {
+        benchWaveform(waves[w]);
+    }
+    for (size_t w = 0; w < recorded.size(); w++) {
+        benchWaveform(recorded[w]);
+    }
+
+    Waveform highRate = synthesize("steady-110@1kHz", 1000, 20, 110, 150, 800, 5);
+    benchHighRate(highRate);
+
+    CPRMetricsBench::run(waves[0]);
+}
+
+} // namespace
+
+#ifdef ARDUINO
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+    setCpuFrequencyMhz(240);
+    BENCH_PRINTF("CPR metrics benchmark, %u MHz, free heap %u\n", (unsigned)ESP.getCpuFreqMHz(), (unsigned)ESP.getFreeHeap());
+
+    std::vector<Waveform> recorded;
+    if (SPIFFS.begin(false)) {
+        File root = SPIFFS.open("/");
+        for (File file = root.openNextFile(); file; file = root.openNextFile()) {
+            String name = file.name();
+            if (!name.endsWith(".csv")) {
+                continue;
+            }
+
+            Waveform wave;
+            wave.name = "recorded";
+            char line[160];
+            // Cap the recording so it fits in RAM next to the synthetic waveforms
+            while (file.available() && wave.samples.size() < 12000) {
+                size_t length = file.readBytesUntil('\n', line, sizeof(line) - 1);
+                line[length] = '\0';
+                appendRecordedLine(wave, line);
+            }
+            BENCH_PRINTF("Recorded waveform: %s (%u samples)\n", name.c_str(), (unsigned)wave.samples.size());
+            recorded.push_back(wave);
+            break;
+        }
+    }
+
+    runSuite(recorded);
+    BENCH_PRINTF("\nDone.\n");
+}
+
+void loop() {
+    delay(1000);
+}
+
+#else
+
+int main(int argc, char** argv) {
+    std::vector<Waveform> recorded;
+    for (int a = 1; a < argc; a++) {
+        FILE* file = fopen(argv[a], "r");
+        if (file == nullptr) {
+            fprintf(stderr, "Cannot open %s\n", argv[a]);
+            return 1;
+        }
+
+        Waveform wave;
+        wave.name = argv[a];
+        char line[256];
+        while (fgets(line, sizeof(line), file) != nullptr) {
+            appendRecordedLine(wave, line);
+        }
+        fclose(file);
+        recorded.push_back(wave);
+    }
+
+    runSuite(recorded);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,189 @@
+// Equivalence check: every channel of MultiChannelCPRCalculator must report
+// what a CPRMetricsCalculator with the same thresholds reports for the same
+// samples (state, rate, CCF, alerts, current peak/min on every sample; depth,
+// recoil and quality counts at the end). Exits non-zero on the first mismatch.
+//
+//   g++ -std=gnu++11 -O2 -Ibench/shim -Isrc -o multichannel_check bench/multichannel_check.cpp
+//       src/CPRMetricsCalculator.cpp src/PeakDetector.cpp src/AutocorrelationRateEstimator.cpp
+//       src/MultiChannelCPRCalculator.cpp
+//   ./multichannel_check [recording.csv ...]
+// or: pio run -e native_check && .pio/build/native_check/program
+
+#include <Arduino.h>
+#include <vector>
+#include "CPRMetricsCalculator.h"
+#include "MultiChannelCPRCalculator.h"
+#include "waveforms.h"
+
+HardwareSerialShim Serial;
+
+namespace {
+
+const size_t CHANNELS = 4;
+const float TOLERANCE = 1e-3f;
+
+bool near(float a, float b) {
+    return fabsf(a - b) <= TOLERANCE;
+}
+
+int failures = 0;
+
+void fail(const char* waveform, size_t ch, size_t sample, const char* field, double expected, double actual) {
+    if (failures++ < 10) {
+        printf("FAIL %s ch%u sample %u: %s expected %.3f, got %.3f\n", waveform, (unsigned)ch, (unsigned)sample,
+               field, expected, actual);
+    }
+}
+
+// Per-channel thresholds: defaults, a longer rate window, a short averaging
+// window and a wider smoothing/trend window
+CPRThresholds channelParams(size_t ch) {
+    CPRThresholds params;
+    switch (ch) {
+        case 1: params.rateWindow = 15; params.rateSmoothingFactor = 0.5f; break;
+        case 2: params.averagingWindow = 10; params.r2 = 250; break;
+        case 3: params.smoothingWindow = 5; params.trendBufferSize = 4; params.c1 = 650; break;
+        default: break;
+    }
+    return params;
+}
+
+// Consecutive segments of synthesize(), so the rate and depth windows see changes
+Waveform rateSteps() {
+    const float rates[] = { 90, 125, 105, 140, 80 };
+    const float peaks[] = { 820, 700, 900, 650, 780 };
+    Waveform wave;
+    wave.name = "rate-steps";
+    for (size_t s = 0; s < sizeof(rates) / sizeof(rates[0]); s++) {
+        Waveform segment = synthesize("", 40, 45, rates[s], 150 + 40 * (s & 1), peaks[s], 8);
+        uint32_t offset = wave.timestamps.empty() ? 0 : wave.timestamps.back() + 25 - segment.timestamps[0];
+        for (size_t i = 0; i < segment.samples.size(); i++) {
+            wave.samples.push_back(segment.samples[i]);
+            wave.timestamps.push_back(segment.timestamps[i] + offset);
+        }
+    }
+    return wave;
+}
+
+void checkSnapshot(const char* name, size_t ch, size_t i, const CPRSnapshot& expected, const CPRSnapshot& actual) {
+    if (expected.state != actual.state) {
+        fail(name, ch, i, "state", (int)expected.state, (int)actual.state);
+    }
+    if (expected.currentRate != actual.currentRate) {
+        fail(name, ch, i, "rate", expected.currentRate, actual.currentRate);
+    }
+    if (!near(expected.ccf, actual.ccf)) {
+        fail(name, ch, i, "ccf", expected.ccf, actual.ccf);
+    }
+    if (expected.alerts.mask != actual.alerts.mask) {
+        fail(name, ch, i, "alerts", expected.alerts.mask, actual.alerts.mask);
+    }
+    if (!near(expected.currentCompression.peakValue, actual.currentCompression.peakValue)) {
+        fail(name, ch, i, "compression peak", expected.currentCompression.peakValue,
+             actual.currentCompression.peakValue);
+    }
+    if (!near(expected.currentRecoil.minValue, actual.currentRecoil.minValue)) {
+        fail(name, ch, i, "recoil min", expected.currentRecoil.minValue, actual.currentRecoil.minValue);
+    }
+}
+
+void checkWaveform(const Waveform& wave) {
+    const size_t n = wave.samples.size();
+    if (n == 0) {
+        return;
+    }
+    int failuresBefore = failures;
+
+    // reset() stamps lastStateChange with millis(); start both engines alike
+    setMillis(wave.timestamps[0]);
+    MultiChannelCPRCalculator multi;
+    multi.configure(CHANNELS);
+    static CPRMetricsCalculator single[CHANNELS];
+    for (size_t ch = 0; ch < CHANNELS; ch++) {
+        multi.setChannelParams(ch, channelParams(ch));
+        single[ch].updateParams(channelParams(ch));
+    }
+
+    // Channel ch sees the waveform shifted by ch * 4 units
+    uint16_t tick[CHANNELS];
+    CPRSnapshot snapshots[CHANNELS];
+    for (size_t i = 0; i < n; i++) {
+        for (size_t ch = 0; ch < CHANNELS; ch++) {
+            tick[ch] = (uint16_t)min(wave.samples[i] + (unsigned)ch * 4, 1023u);
+        }
+        multi.process(tick, wave.timestamps[i], snapshots);
+
+        for (size_t ch = 0; ch < CHANNELS; ch++) {
+            CPRSnapshot expected;
+            single[ch].detectTrendBatch(&tick[ch], &wave.timestamps[i], 1, &expected);
+            checkSnapshot(wave.name, ch, i, expected, snapshots[ch]);
+        }
+    }
+
+    for (size_t ch = 0; ch < CHANNELS; ch++) {
+        CompressionMetrics expectedDepth = single[ch].getCompressionMetrics();
+        CompressionMetrics depth = multi.getCompressionMetrics(ch);
+        RecoilMetrics expectedRecoil = single[ch].getRecoilMetrics();
+        RecoilMetrics recoil = multi.getRecoilMetrics(ch);
+
+        if (!near(expectedDepth.average, depth.average)) {
+            fail(wave.name, ch, n, "depth average", expectedDepth.average, depth.average);
+        }
+        if (expectedDepth.good != depth.good || expectedDepth.total != depth.total) {
+            fail(wave.name, ch, n, "good/total compressions", expectedDepth.good * 10000.0 + expectedDepth.total,
+                 depth.good * 10000.0 + depth.total);
+        }
+        if (!near(single[ch].getAverageRecoil(), multi.getAverageRecoil(ch))) {
+            fail(wave.name, ch, n, "recoil average", single[ch].getAverageRecoil(), multi.getAverageRecoil(ch));
+        }
+        if (expectedRecoil.goodRecoil != recoil.goodRecoil ||
+            expectedRecoil.incompleteRecoil != recoil.incompleteRecoil || expectedRecoil.total != recoil.total) {
+            fail(wave.name, ch, n, "good/incomplete recoils",
+                 expectedRecoil.goodRecoil * 10000.0 + expectedRecoil.incompleteRecoil,
+                 recoil.goodRecoil * 10000.0 + recoil.incompleteRecoil);
+        }
+    }
+
+    CompressionMetrics summary = multi.getCompressionMetrics(0);
+    printf("%-18s %s  %u samples x %u ch, ch0: %d cpm, %d/%d good, depth %.1f\n", wave.name,
+           failures == failuresBefore ? "ok  " : "FAIL", (unsigned)n, (unsigned)CHANNELS,
+           multi.getSnapshot(0, wave.timestamps[n - 1]).currentRate, summary.good, summary.total, summary.average);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<Waveform> waves;
+    waves.push_back(synthesize("steady-110", 40, 300, 110, 150, 800, 5));
+    waves.push_back(synthesize("fast-shallow-140", 40, 300, 140, 200, 650, 5));
+    waves.push_back(synthesize("noisy-100", 40, 300, 100, 150, 850, 40));
+    waves.push_back(synthesize("pauses-30s", 40, 300, 110, 150, 800, 5, 30, 5));
+    waves.push_back(rateSteps());
+
+    for (int a = 1; a < argc; a++) {
+        FILE* file = fopen(argv[a], "r");
+        if (file == nullptr) {
+            fprintf(stderr, "Cannot open %s\n", argv[a]);
+            return 1;
+        }
+
+        Waveform wave;
+        wave.name = argv[a];
+        char line[256];
+        while (fgets(line, sizeof(line), file) != nullptr) {
+            appendRecordedLine(wave, line);
+        }
+        fclose(file);
+        waves.push_back(wave);
+    }
+
+    for (size_t w = 0; w < waves.size(); w++) {
+        checkWaveform(waves[w]);
+    }
+
+    if (failures > 0) {
+        printf("%d mismatches\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+#ifndef BENCH_ARDUINO_SHIM_H
+#define BENCH_ARDUINO_SHIM_H
+
+// Minimal Arduino surface for building the metrics code natively on Linux.
+// Only what CPRMetricsCalculator, PeakDetector, MultiChannelCPRCalculator and
+// SessionReplay use; networking, SPIFFS and the web server are not shimmed.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+
+using std::max;
+using std::min;
+
+#define PROGMEM
+#define IRAM_ATTR
+#define F(text) (text)
+
+// Benchmarks drive time explicitly; millis() returns whatever was set last
+namespace shim {
+inline unsigned long& fakeMillis() {
+    static unsigned long value = 0;
+    return value;
+}
+} // namespace shim
+
+inline void setMillis(unsigned long value) { shim::fakeMillis() = value; }
+inline unsigned long millis() { return shim::fakeMillis(); }
+
+inline unsigned long micros() {
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// Serial output is discarded unless BENCH_VERBOSE is defined
+class HardwareSerialShim {
+public:
+    void begin(unsigned long) {}
+    void println(const char* text = "") {
+#ifdef BENCH_VERBOSE
+        puts(text);
+#else
+        (void)text;
+#endif
+    }
+    void printf(const char* format, ...) {
+#ifdef BENCH_VERBOSE
+        va_list args;
+        va_start(args, format);
+        vprintf(format, args);
+        va_end(args);
+#else
+        (void)format;
+#endif
+    }
+};
+
+extern HardwareSerialShim Serial;   // Defined by the benchmark main
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef BENCH_WAVEFORMS_H
+#define BENCH_WAVEFORMS_H
+
+// Test waveforms shared by the host programs in bench/: deterministic
+// synthetic compressions, and rows of a recorded writeCSVData() file.
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <vector>
+
+struct Waveform {
+    const char* name;
+    std::vector<uint16_t> samples;     // Calculator units (0-1023)
+    std::vector<uint32_t> timestamps;  // ms
+};
+
+// Deterministic noise so host and target see identical inputs
+struct Lcg {
+    uint32_t state;
+    explicit Lcg(uint32_t seed) : state(seed) {}
+    int next(int amplitude) {
+        state = state * 1103515245u + 12345u;
+        return (int)((state >> 16) % (2 * amplitude + 1)) - amplitude;
+    }
+};
+
+// Raised-cosine compressions from 'baseline' to 'peak' at 'rateCpm', sampled
+// at 'sampleRateHz'. pauseEverySec > 0 inserts pauseSec of rest each cycle.
+inline Waveform synthesize(const char* name, int sampleRateHz, float seconds, float rateCpm, float baseline,
+                           float peak, int noise, float pauseEverySec = 0, float pauseSec = 0) {
+    Waveform wave;
+    wave.name = name;
+    size_t count = (size_t)(seconds * sampleRateHz);
+    wave.samples.reserve(count);
+    wave.timestamps.reserve(count);
+
+    Lcg lcg(12345);
+    float period = 60.0f / rateCpm;
+    for (size_t i = 0; i < count; i++) {
+        float t = (float)i / sampleRateHz;
+        float value = baseline;
+        bool pausing = pauseEverySec > 0 && fmodf(t, pauseEverySec) >= pauseEverySec - pauseSec;
+        if (!pausing) {
+            // Slight beat-to-beat variation in depth
+            float beat = floorf(t / period);
+            float depth = (peak - baseline) * (0.9f + 0.1f * sinf(beat * 0.7f));
+            value = baseline + depth * 0.5f * (1 - cosf(2 * (float)M_PI * t / period));
+        }
+        value += lcg.next(noise);
+        value = max(0.0f, min(value, 1023.0f));
+
+        wave.samples.push_back((uint16_t)value);
+        wave.timestamps.push_back(1000 + (uint32_t)(i * 1000 / sampleRateHz));
+    }
+    return wave;
+}
+
+// Timestamp and ScaledValue from a writeCSVData() row
+inline bool parseRecordedLine(const char* line, uint32_t& timestamp, uint16_t& value) {
+    unsigned long ts;
+    unsigned scaled;
+    if (sscanf(line, "%*[^,],%*d,%lu,%*d,%u", &ts, &scaled) != 2) {
+        return false;   // Header or malformed
+    }
+    timestamp = (uint32_t)ts;
+    value = (uint16_t)min(scaled, 1023u);
+    return true;
+}
+
+inline void appendRecordedLine(Waveform& wave, const char* line) {
+    uint32_t timestamp;
+    uint16_t value;
+    if (parseRecordedLine(line, timestamp, value)) {
+        wave.samples.push_back(value);
+        wave.timestamps.push_back(timestamp);
+    }
+}
+
+#endif
@@ -0,0 +1,65 @@
+#include "AdcCalibration.h"
+
+#if defined(ESP32) && defined(__has_include)
+#if __has_include(<esp_adc_cal.h>)
+#include <esp_adc_cal.h>
+#define CPR_ADC_USE_EFUSE_CAL 1
+#endif
+#endif
+
+AdcCalibration::AdcCalibration() : source(Source::Linear) {
+    buildLinear();
+}
+
+void AdcCalibration::buildLinear() {
+    const uint32_t fullScale = (uint32_t)FULL_SCALE << TABLE_SHIFT;
+    for (uint32_t code = 0; code <= MAX_CODE; code++) {
+        table[code] = (uint16_t)((code * fullScale + MAX_CODE / 2) / MAX_CODE);
+    }
+    source = Source::Linear;
+}
+
+void AdcCalibration::begin() {
+    buildLinear();
+
+#ifdef CPR_ADC_USE_EFUSE_CAL
+    esp_adc_cal_characteristics_t characteristics;
+    esp_adc_cal_value_t calibration = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12,
+                                                               1100, &characteristics);
+    if (calibration == ESP_ADC_CAL_VAL_DEFAULT_VREF) {
+        // Without eFuse data the curve is a guess; keep the straight line
+        Serial.println("ADC Calibration: no eFuse data, using linear table");
+        return;
+    }
+
+    uint32_t lowMillivolts = esp_adc_cal_raw_to_voltage(0, &characteristics);
+    uint32_t highMillivolts = esp_adc_cal_raw_to_voltage(MAX_CODE, &characteristics);
+    if (highMillivolts <= lowMillivolts) {
+        Serial.println("ADC Calibration: degenerate eFuse curve, using linear table");
+        return;
+    }
+
+    const uint32_t fullScale = (uint32_t)FULL_SCALE << TABLE_SHIFT;
+    const uint32_t span = highMillivolts - lowMillivolts;
+    uint16_t previous = 0;
+    for (uint32_t code = 0; code <= MAX_CODE; code++) {
+        uint32_t millivolts = esp_adc_cal_raw_to_voltage(code, &characteristics);
+        millivolts = constrain(millivolts, lowMillivolts, highMillivolts);
+        uint16_t entry = (uint16_t)(((millivolts - lowMillivolts) * fullScale + span / 2) / span);
+        // Interpolation assumes a monotonic table
+        table[code] = previous = max(previous, entry);
+    }
+
+    source = (calibration == ESP_ADC_CAL_VAL_EFUSE_TP) ? Source::EfuseTwoPoint : Source::EfuseVref;
+    Serial.printf("ADC Calibration: %s curve, %lu-%lu mV mapped to 0-%.0f\n", getSourceName(),
+                  (unsigned long)lowMillivolts, (unsigned long)highMillivolts, FULL_SCALE);
+#endif
+}
+
+const char* AdcCalibration::getSourceName() const {
+    switch (source) {
+        case Source::EfuseVref: return "efuse_vref";
+        case Source::EfuseTwoPoint: return "efuse_two_point";
+        default: return "linear";
+    }
+}
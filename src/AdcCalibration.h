@@ -0,0 +1,69 @@
+#ifndef ADC_CALIBRATION_H
+#define ADC_CALIBRATION_H
+
+#include <Arduino.h>
+
+// Converts potentiometer ADC codes to the calculator's 0-1023 units through a
+// table built once at startup, in place of per-sample map() arithmetic.
+//
+// Codes are 12.4 fixed point: a 12-bit ADC code carrying FRACTION_BITS of
+// extra precision from oversampling. The fraction interpolates between
+// adjacent table entries, so an averaged sample keeps its sub-LSB resolution
+// instead of being truncated to whole 10-bit steps.
+//
+// When the chip has eFuse ADC calibration the table follows the characterised
+// voltage curve (the ESP32 ADC is noticeably non-linear at 11 dB), rescaled so
+// codes 0 and 4095 still map to 0 and 1023 and existing thresholds keep their
+// meaning. Otherwise it is the same straight line map() produced.
+class AdcCalibration {
+public:
+    static constexpr int CODE_BITS = 12;
+    static constexpr int FRACTION_BITS = 4;
+    static constexpr uint32_t MAX_CODE = (1UL << CODE_BITS) - 1;
+    static constexpr uint32_t MAX_FIXED_CODE = MAX_CODE << FRACTION_BITS;
+    static constexpr float FULL_SCALE = 1023.0f;
+
+    enum class Source : uint8_t {
+        Linear = 0,
+        EfuseVref,
+        EfuseTwoPoint
+    };
+
+private:
+    static constexpr int TABLE_SHIFT = 6;   // Entries in 1/64 units (1023 * 64 fits 16 bits)
+
+    uint16_t table[MAX_CODE + 1];
+    Source source;
+
+    void buildLinear();
+
+public:
+    AdcCalibration();
+
+    // Characterises ADC1 at 11 dB (as analogRead() configures it) and rebuilds
+    // the table; call once from setup()
+    void begin();
+
+    Source getSource() const { return source; }
+    const char* getSourceName() const;
+
+    // 12.4 fixed-point code -> calculator units (0-1023)
+    float toUnits(uint32_t fixedCode) const {
+        uint32_t index = fixedCode >> FRACTION_BITS;
+        if (index >= MAX_CODE) {
+            return table[MAX_CODE] * (1.0f / (1 << TABLE_SHIFT));
+        }
+        int32_t low = table[index];
+        int32_t high = table[index + 1];
+        int32_t fraction = fixedCode & ((1 << FRACTION_BITS) - 1);
+        int32_t interpolated = (low << FRACTION_BITS) + (high - low) * fraction;
+        return interpolated * (1.0f / (1 << (TABLE_SHIFT + FRACTION_BITS)));
+    }
+
+    // 12.4 fixed-point code -> nearest whole 12-bit code
+    static uint16_t toRawCode(uint32_t fixedCode) {
+        return (uint16_t)((fixedCode + (1 << (FRACTION_BITS - 1))) >> FRACTION_BITS);
+    }
+};
+
+#endif
@@ -0,0 +1,285 @@
+#include "AdcSampler.h"
+#include <driver/adc.h>
+#include <esp_timer.h>
+
+AdcSampler* AdcSampler::timerOwner = nullptr;
+
+AdcSampler::AdcSampler()
+    : task(nullptr),
+      timer(nullptr),
+      mode(AcquisitionMode::Dma),
+      pin(0),
+      channel(0),
+      running(false),
+      requestedRateHz(40),
+      sampleRateHz(0),
+      oversample(1),
+      accumulator(0),
+      accumulated(0),
+      samplesProduced(0),
+      dmaOverruns(0),
+      readErrors(0),
+      startMicros(0) {
+}
+
+bool AdcSampler::begin(uint8_t adcPin, int rateHz, AcquisitionMode acquisitionMode) {
+    if (running) {
+        setSampleRate(rateHz);
+        return true;
+    }
+
+    int8_t adcChannel = digitalPinToAnalogChannel(adcPin);
+    if (adcChannel < 0 || adcChannel >= SOC_ADC_CHANNEL_NUM(0)) {
+        Serial.printf("ADC Sampler: GPIO %d is not an ADC1 pin\n", adcPin);
+        return false;
+    }
+    pin = adcPin;
+    channel = (uint8_t)adcChannel;
+    mode = acquisitionMode;
+
+    setSampleRate(rateHz);
+    applySampleRate(requestedRateHz.load());
+
+    if (mode == AcquisitionMode::Dma && !startDma()) {
+        return false;
+    }
+
+    startMicros = esp_timer_get_time();
+    BaseType_t created = xTaskCreatePinnedToCore(taskEntry, "adc_sampler", TASK_STACK_SIZE, this,
+                                                 TASK_PRIORITY, &task, TASK_CORE);
+    if (created != pdPASS) {
+        Serial.println("ADC Sampler: failed to create acquisition task");
+        if (mode == AcquisitionMode::Dma) {
+            adc_digi_stop();
+            adc_digi_deinitialize();
+        }
+        return false;
+    }
+
+    // The timer notifies the task, so it starts once the task exists
+    if (mode == AcquisitionMode::Timer && !startTimer()) {
+        vTaskDelete(task);
+        task = nullptr;
+        return false;
+    }
+
+    running = true;
+    if (mode == AcquisitionMode::Dma) {
+        Serial.printf("ADC Sampler: DMA %lu Hz -> %d Hz (x%lu oversampling) on core %d\n",
+                      (unsigned long)DMA_SAMPLE_RATE_HZ, sampleRateHz, (unsigned long)oversample, TASK_CORE);
+    } else {
+        Serial.printf("ADC Sampler: hardware timer %d at %d Hz on core %d\n", TIMER_NUMBER, sampleRateHz, TASK_CORE);
+    }
+    return true;
+}
+
+bool AdcSampler::startDma() {
+    adc_digi_init_config_t init = {};
+    init.max_store_buf_size = DMA_FRAME_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES * 4;
+    init.conv_num_each_intr = DMA_FRAME_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES;
+    init.adc1_chan_mask = BIT(channel);
+    init.adc2_chan_mask = 0;
+
+    esp_err_t err = adc_digi_initialize(&init);
+    if (err != ESP_OK) {
+        Serial.printf("ADC Sampler: adc_digi_initialize failed (%d)\n", err);
+        return false;
+    }
+
+    adc_digi_pattern_config_t pattern = {};
+    pattern.atten = ADC_ATTEN_DB_11;    // Full 0-3.3V range, as analogRead()
+    pattern.channel = channel;
+    pattern.unit = 0;                   // ADC1
+    pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+    adc_digi_configuration_t config = {};
+    config.conv_limit_en = true;        // Required on ESP32
+    config.conv_limit_num = 250;
+    config.pattern_num = 1;
+    config.adc_pattern = &pattern;
+    config.sample_freq_hz = DMA_SAMPLE_RATE_HZ;
+    config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+
+    err = adc_digi_controller_configure(&config);
+    if (err == ESP_OK) {
+        err = adc_digi_start();
+    }
+    if (err != ESP_OK) {
+        Serial.printf("ADC Sampler: DMA configuration failed (%d)\n", err);
+        adc_digi_deinitialize();
+        return false;
+    }
+    return true;
+}
+
+bool AdcSampler::startTimer() {
+    if (timerOwner != nullptr) {
+        Serial.println("ADC Sampler: timer already owned by another sampler");
+        return false;
+    }
+
+    timer = timerBegin(TIMER_NUMBER, TIMER_DIVIDER, true);
+    if (timer == nullptr) {
+        Serial.println("ADC Sampler: timerBegin failed");
+        return false;
+    }
+
+    timerOwner = this;
+    timerAttachInterrupt(timer, &AdcSampler::onTimer, true);
+    timerAlarmWrite(timer, 1000000UL / sampleRateHz, true);
+    timerAlarmEnable(timer);
+    return true;
+}
+
+void IRAM_ATTR AdcSampler::onTimer() {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(timerOwner->task, &woken);
+    if (woken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+void AdcSampler::setSampleRate(int rateHz) {
+    requestedRateHz.store(max(1, min(rateHz, (int)MAX_SAMPLE_RATE_HZ)));
+}
+
+// Acquisition task only (or before it starts)
+void AdcSampler::applySampleRate(int rateHz) {
+    sampleRateHz = rateHz;
+    accumulator = 0;
+    accumulated = 0;
+
+    uint32_t periodMicros;
+    if (mode == AcquisitionMode::Dma) {
+        oversample = max(1UL, (unsigned long)(DMA_SAMPLE_RATE_HZ / rateHz));
+        periodMicros = oversample * (1000000UL / DMA_SAMPLE_RATE_HZ);
+    } else {
+        oversample = BURST_READS;
+        periodMicros = 1000000UL / rateHz;
+        if (timer != nullptr) {
+            timerAlarmWrite(timer, periodMicros, true);
+        }
+    }
+    timing.configure(periodMicros);
+}
+
+void AdcSampler::taskEntry(void* arg) {
+    AdcSampler* sampler = static_cast<AdcSampler*>(arg);
+    if (sampler->mode == AcquisitionMode::Dma) {
+        sampler->runDma();
+    } else {
+        sampler->runTimer();
+    }
+}
+
+void AdcSampler::pushSample(const AdcSample& sample) {
+    timing.record(sample.timestampMicros);
+    ring.push(sample);
+    samplesProduced.fetch_add(1);
+}
+
+void AdcSampler::runTimer() {
+    for (;;) {
+        // Several pending notifications mean ticks were missed; the timing
+        // monitor sees them as one long interval
+        uint32_t ticks = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(READ_TIMEOUT_MS));
+        if (ticks == 0) {
+            readErrors.fetch_add(1); // Timer stopped firing
+            continue;
+        }
+
+        int rate = requestedRateHz.load();
+        if (rate != sampleRateHz) {
+            applySampleRate(rate);
+            continue;
+        }
+
+        // Stamp the middle of the burst, like the DMA averaging window
+        int64_t burstStart = esp_timer_get_time();
+        AdcSample sample;
+        sample.code = readOversampled(pin);
+        sample.timestampMicros = (burstStart + esp_timer_get_time()) / 2;
+        pushSample(sample);
+    }
+}
+
+void AdcSampler::runDma() {
+    const int64_t conversionMicros = 1000000 / DMA_SAMPLE_RATE_HZ;
+    int64_t lastTimestamp = 0;
+
+    for (;;) {
+        int rate = requestedRateHz.load();
+        if (rate != sampleRateHz) {
+            applySampleRate(rate);
+        }
+
+        uint32_t length = 0;
+        esp_err_t err = adc_digi_read_bytes(frame, sizeof(frame), &length, READ_TIMEOUT_MS);
+        int64_t readMicros = esp_timer_get_time();
+
+        if (err == ESP_ERR_INVALID_STATE) {
+            dmaOverruns.fetch_add(1); // Frames were lost, but this read still returned data
+        } else if (err != ESP_OK) {
+            readErrors.fetch_add(1);
+            continue;
+        }
+
+        // The last conversion in the frame completed just before the read
+        // returned; earlier ones are spaced by the DMA conversion period
+        size_t count = length / SOC_ADC_DIGI_RESULT_BYTES;
+        for (size_t i = 0; i < count; i++) {
+            const adc_digi_output_data_t* result =
+                reinterpret_cast<const adc_digi_output_data_t*>(&frame[i * SOC_ADC_DIGI_RESULT_BYTES]);
+            if (result->type1.channel != channel) {
+                continue;
+            }
+
+            accumulator += result->type1.data;
+            if (++accumulated < oversample) {
+                continue;
+            }
+
+            AdcSample sample;
+            sample.code = (uint16_t)(((accumulator << AdcCalibration::FRACTION_BITS) + oversample / 2) / oversample);
+            sample.timestampMicros = readMicros - (int64_t)(count - 1 - i) * conversionMicros -
+                                     (oversample * conversionMicros) / 2;
+            // Keep timestamps strictly increasing across frame boundaries
+            if (sample.timestampMicros <= lastTimestamp) {
+                sample.timestampMicros = lastTimestamp + 1;
+            }
+            lastTimestamp = sample.timestampMicros;
+
+            pushSample(sample);
+            accumulator = 0;
+            accumulated = 0;
+        }
+    }
+}
+
+uint16_t AdcSampler::readOversampled(uint8_t adcPin) {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < BURST_READS; i++) {
+        sum += analogRead(adcPin);
+    }
+    return (uint16_t)(((sum << AdcCalibration::FRACTION_BITS) + BURST_READS / 2) / BURST_READS);
+}
+
+AdcSamplerStats AdcSampler::getStats() const {
+    AdcSamplerStats stats;
+    stats.running = running;
+    stats.mode = mode;
+    stats.sampleRateHz = sampleRateHz;
+    stats.oversample = oversample;
+    stats.samples = samplesProduced.load();
+    stats.ringOverflows = ring.overflows();
+    stats.dmaOverruns = dmaOverruns.load();
+    stats.readErrors = readErrors.load();
+    stats.queued = ring.size();
+
+    int64_t elapsed = esp_timer_get_time() - startMicros;
+    if (running && elapsed > 0) {
+        stats.measuredRateHz = stats.samples * 1e6f / elapsed;
+    }
+    return stats;
+}
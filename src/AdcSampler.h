@@ -0,0 +1,124 @@
+#ifndef ADC_SAMPLER_H
+#define ADC_SAMPLER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "SpscRing.h"
+#include "SampleTimingMonitor.h"
+#include "AdcCalibration.h"
+
+// How samples are clocked
+enum class AcquisitionMode : uint8_t {
+    Dma = 0,    // ADC DMA at DMA_SAMPLE_RATE_HZ, averaged down to the sample rate
+    Timer       // Hardware timer interrupt per sample, a burst of analogRead()s each
+};
+
+// One output sample: the mean of 'oversample' conversions as a 12.4
+// fixed-point code (see AdcCalibration) and the esp_timer time of the middle
+// of that averaging window (so timestampMicros / 1000 is on the millis() clock)
+struct AdcSample {
+    int64_t timestampMicros;
+    uint16_t code;
+};
+
+struct AdcSamplerStats {
+    bool running = false;
+    AcquisitionMode mode = AcquisitionMode::Dma;
+    int sampleRateHz = 0;           // Output rate into the ring
+    uint32_t oversample = 0;        // Conversions averaged per output sample
+    uint32_t samples = 0;           // Output samples produced since begin()
+    uint32_t ringOverflows = 0;     // Samples dropped because the consumer fell behind
+    uint32_t dmaOverruns = 0;       // DMA frames lost because the task fell behind
+    uint32_t readErrors = 0;
+    size_t queued = 0;              // Samples waiting in the ring
+    float measuredRateHz = 0;       // samples / elapsed time since begin()
+};
+
+// Continuous ADC1 acquisition for one channel. A task pinned to TASK_CORE
+// pushes timestamped samples into a lock-free SPSC ring that the metrics task
+// drains, so sampling continues at a constant rate while that task is held
+// up; the ring absorbs up to RING_SIZE samples.
+//
+// In Dma mode the ADC converts continuously at DMA_SAMPLE_RATE_HZ and the
+// task boxcar-averages the conversions down to the sample rate. In Timer mode
+// a hardware timer interrupt wakes the task once per sample period, the task
+// averages a burst of BURST_READS conversions and stamps the sample with
+// esp_timer. Either way the average keeps its fractional bits, so the output
+// has more resolution than a single 12-bit conversion.
+//
+// Every sample timestamp also feeds a SampleTimingMonitor (interval jitter
+// histogram and missed deadlines), readable from any task.
+class AdcSampler {
+public:
+    static constexpr size_t RING_SIZE = 512;                // ~0.5 s at 1 kHz, ~12 s at 40 Hz
+    static constexpr uint32_t DMA_SAMPLE_RATE_HZ = 20000;   // ESP32 DMA minimum
+    static constexpr size_t DMA_FRAME_SAMPLES = 256;        // Conversions per DMA interrupt (12.8 ms)
+    static constexpr int MAX_SAMPLE_RATE_HZ = 1000;
+    static constexpr int TASK_CORE = 1;
+    static constexpr UBaseType_t TASK_PRIORITY = 10;        // Above the metrics task (5) and loop() (1) on the same core
+    static constexpr uint32_t TASK_STACK_SIZE = 4096;
+    static constexpr uint32_t READ_TIMEOUT_MS = 100;
+    static constexpr uint8_t TIMER_NUMBER = 0;
+    static constexpr uint16_t TIMER_DIVIDER = 80;           // 80 MHz APB -> 1 us ticks
+    static constexpr uint32_t BURST_READS = 16;             // Conversions per Timer-mode sample (~160 us)
+
+private:
+    SpscRing<AdcSample, RING_SIZE> ring;
+    TaskHandle_t task;
+    hw_timer_t* timer;
+    AcquisitionMode mode;
+    uint8_t pin;
+    uint8_t channel;
+    bool running;
+    SampleTimingMonitor timing;
+
+    // Output rate; requested from any task, applied by the acquisition task
+    std::atomic<int> requestedRateHz;
+    int sampleRateHz;
+    uint32_t oversample;
+    uint32_t accumulator;
+    uint32_t accumulated;
+
+    std::atomic<uint32_t> samplesProduced;
+    std::atomic<uint32_t> dmaOverruns;
+    std::atomic<uint32_t> readErrors;
+    int64_t startMicros;
+
+    uint8_t frame[DMA_FRAME_SAMPLES * 4];   // Room for the largest result format
+
+    static AdcSampler* timerOwner;      // Timer ISR has no argument
+    static void IRAM_ATTR onTimer();
+    static void taskEntry(void* arg);
+    void runDma();
+    void runTimer();
+    bool startDma();
+    bool startTimer();
+    void applySampleRate(int rateHz);
+    void pushSample(const AdcSample& sample);
+
+public:
+    AdcSampler();
+
+    // Starts the acquisition task and its clock. Only ADC1 pins (GPIO 32-39)
+    // are supported, since ADC2 is unavailable while WiFi is on. A failed
+    // begin() leaves the ADC free, so it can be retried in the other mode.
+    bool begin(uint8_t adcPin, int rateHz, AcquisitionMode acquisitionMode = AcquisitionMode::Dma);
+    void setSampleRate(int rateHz);
+
+    // BURST_READS back-to-back analogRead()s averaged to a 12.4 fixed-point
+    // code; also used by the metrics task when the acquisition task is unavailable
+    static uint16_t readOversampled(uint8_t adcPin);
+
+    // Consumer side (one task only)
+    bool pop(AdcSample& sample) { return ring.pop(sample); }
+    void discard() { ring.discard(); }
+    size_t queued() const { return ring.size(); }
+
+    bool isRunning() const { return running; }
+    AcquisitionMode getMode() const { return mode; }
+    AdcSamplerStats getStats() const;
+    SampleTimingMonitor::Snapshot getTiming() const { return timing.read(); }
+    void resetTiming() { timing.requestReset(); }
+};
+
+#endif
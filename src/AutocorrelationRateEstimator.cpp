@@ -0,0 +1,164 @@
+#include "AutocorrelationRateEstimator.h"
+#include <cmath>
+
+#if defined(ESP32) && defined(__has_include)
+#if __has_include(<dsps_corr.h>)
+#include <dsps_corr.h>
+#define CPR_RATE_USE_ESP_DSP 1
+#endif
+#endif
+
+namespace {
+
+// out[k] = sum over m < overlap of x[m + k] * x[m], for k = 0..lags-1.
+// x must hold at least overlap + lags - 1 samples.
+void autocorrelate(const float* x, size_t overlap, size_t lags, float* out) {
+#ifdef CPR_RATE_USE_ESP_DSP
+    // Same definition: dest[n] = sum Signal[n + m] * Pattern[m]
+    dsps_corr_f32(x, (int)(overlap + lags - 1), x, (int)overlap, out);
+#else
+    for (size_t k = 0; k < lags; k++) {
+        const float* shifted = x + k;
+        float sum = 0;
+        for (size_t m = 0; m < overlap; m++) {
+            sum += shifted[m] * x[m];
+        }
+        out[k] = sum;
+    }
+#endif
+}
+
+} // namespace
+
+AutocorrelationRateEstimator::AutocorrelationRateEstimator() {
+    configure(40);
+}
+
+void AutocorrelationRateEstimator::configure(int sampleRate) {
+    sampleRateHz = max(1, sampleRate);
+
+    windowSize = (size_t)lroundf(WINDOW_SECONDS * sampleRateHz);
+    windowSize = max((size_t)8, min(windowSize, (size_t)MAX_WINDOW));
+    minWindow = min((size_t)lroundf(MIN_WINDOW_SECONDS * sampleRateHz), windowSize);
+    updateInterval = max((size_t)1, (size_t)lroundf(UPDATE_SECONDS * sampleRateHz));
+
+    // Lag range for the rate range; the upper end is further limited to half
+    // the samples available so every lag has a reasonable overlap
+    minLag = max((size_t)2, (size_t)floorf(60.0f * sampleRateHz / MAX_RATE_CPM));
+    maxLag = (size_t)ceilf(60.0f * sampleRateHz / MIN_RATE_CPM);
+
+    reset();
+}
+
+void AutocorrelationRateEstimator::reset() {
+    head = 0;
+    count = 0;
+    sinceUpdate = updateInterval; // Estimate as soon as minWindow samples are in
+    rate = 0;
+    confidence = 0;
+    valid = false;
+}
+
+bool AutocorrelationRateEstimator::push(float value) {
+    samples[head] = value;
+    head = (head + 1 == windowSize) ? 0 : head + 1;
+    if (count < windowSize) {
+        count++;
+    }
+
+    if (sinceUpdate < updateInterval) {
+        sinceUpdate++;
+    }
+    if (count < minWindow || sinceUpdate < updateInterval) {
+        return false;
+    }
+
+    sinceUpdate = 0;
+    estimate();
+    return true;
+}
+
+void AutocorrelationRateEstimator::estimate() {
+    size_t n = count;
+    size_t oldest = (head + windowSize - count) % windowSize;
+
+    // Unroll the ring into chronological order for the kernel
+    float mean = 0;
+    size_t index = oldest;
+    for (size_t i = 0; i < n; i++) {
+        linear[i] = samples[index];
+        mean += linear[i];
+        index = (index + 1 == windowSize) ? 0 : index + 1;
+    }
+    mean /= n;
+
+    float energy = 0;
+    for (size_t i = 0; i < n; i++) {
+        linear[i] -= mean;
+        energy += linear[i] * linear[i];
+    }
+
+    if (sqrtf(energy / n) < MIN_AMPLITUDE) {
+        // Idle: keep only the newest samples so the next estimate is not
+        // diluted by the rest period before compressions (re)start
+        count = min(count, updateInterval);
+        valid = false;
+        confidence = 0;
+        return;
+    }
+
+    size_t lagHigh = min(maxLag, n / 2);
+    if (lagHigh < minLag + 2) {
+        valid = false;
+        confidence = 0;
+        return;
+    }
+
+    // One extra lag on each side of the search range for the parabola
+    size_t lags = lagHigh + 2;
+    autocorrelate(linear, n - lags + 1, lags, correlation);
+
+    float zeroLag = correlation[0];
+    if (zeroLag <= 0) {
+        valid = false;
+        confidence = 0;
+        return;
+    }
+
+    // Strongest local maximum in the search range
+    float best = 0;
+    for (size_t k = minLag; k <= lagHigh; k++) {
+        if (correlation[k] >= correlation[k - 1] && correlation[k] > correlation[k + 1]) {
+            best = max(best, correlation[k]);
+        }
+    }
+
+    // Shortest lag whose peak is nearly as strong: a period of two
+    // compressions correlates as well as one, but the rate is the shorter one
+    size_t chosen = 0;
+    for (size_t k = minLag; k <= lagHigh && best > 0; k++) {
+        if (correlation[k] >= correlation[k - 1] && correlation[k] > correlation[k + 1] &&
+            correlation[k] >= OCTAVE_RATIO * best) {
+            chosen = k;
+            break;
+        }
+    }
+
+    confidence = (chosen > 0) ? correlation[chosen] / zeroLag : 0;
+    if (chosen == 0 || confidence < MIN_CORRELATION) {
+        valid = false;
+        return;
+    }
+
+    // Vertex of the parabola through the peak and its neighbours
+    float before = correlation[chosen - 1];
+    float peak = correlation[chosen];
+    float after = correlation[chosen + 1];
+    float denominator = before - 2 * peak + after;
+    float offset = (denominator < 0) ? 0.5f * (before - after) / denominator : 0;
+    offset = max(-0.5f, min(offset, 0.5f));
+
+    float estimatedRate = 60.0f * sampleRateHz / (chosen + offset);
+    rate = valid ? RATE_SMOOTHING * estimatedRate + (1 - RATE_SMOOTHING) * rate : estimatedRate;
+    valid = true;
+}
@@ -0,0 +1,69 @@
+#ifndef AUTOCORRELATION_RATE_ESTIMATOR_H
+#define AUTOCORRELATION_RATE_ESTIMATOR_H
+
+#include <Arduino.h>
+
+// Compression rate from the periodicity of the sample stream itself rather
+// than from detected onsets. Every UPDATE_SECONDS the last WINDOW_SECONDS of
+// samples are mean-removed and autocorrelated over the lags that correspond
+// to MIN_RATE_CPM..MAX_RATE_CPM; the strongest peak (preferring the shortest
+// lag among near-equal peaks, so a missed or shallow compression does not
+// halve the rate) is refined with a parabola and converted to a rate.
+//
+// The first estimate is available after MIN_WINDOW_SECONDS of samples, and a
+// compression the onset detector misses still contributes to the waveform,
+// so the estimate does not drop when onsets are lost.
+//
+// On ESP32 the correlation runs on the esp-dsp kernel when it is available;
+// elsewhere a portable loop computes the same values.
+class AutocorrelationRateEstimator {
+public:
+    static constexpr size_t MAX_WINDOW = 256;
+    static constexpr size_t MAX_LAGS = MAX_WINDOW / 2 + 2;
+    static constexpr float WINDOW_SECONDS = 3.2f;
+    static constexpr float MIN_WINDOW_SECONDS = 1.5f;
+    static constexpr float UPDATE_SECONDS = 0.25f;
+    static constexpr float MIN_RATE_CPM = 60.0f;
+    static constexpr float MAX_RATE_CPM = 180.0f;
+    static constexpr float MIN_CORRELATION = 0.2f;   // Normalised peak needed to report a rate
+    static constexpr float OCTAVE_RATIO = 0.85f;     // Shorter-lag peak wins if at least this strong
+    static constexpr float MIN_AMPLITUDE = 50.0f;    // Std dev (calculator units) below which the signal is idle
+    static constexpr float RATE_SMOOTHING = 0.5f;
+
+private:
+    float samples[MAX_WINDOW];      // Ring of the most recent samples
+    float linear[MAX_WINDOW];       // Chronological, mean-removed copy for the kernel
+    float correlation[MAX_LAGS];
+    size_t windowSize;
+    size_t minWindow;
+    size_t head;
+    size_t count;
+    size_t updateInterval;
+    size_t sinceUpdate;
+    size_t minLag;
+    size_t maxLag;
+    int sampleRateHz;
+
+    float rate;
+    float confidence;
+    bool valid;
+
+    void estimate();
+
+public:
+    AutocorrelationRateEstimator();
+
+    // Sizes the window and lag range for the given sample rate and clears it
+    void configure(int sampleRate);
+    void reset();
+
+    // Feed one sample; returns true when a new estimate was computed (which
+    // may have found no rate, see hasEstimate())
+    bool push(float value);
+
+    bool hasEstimate() const { return valid; }
+    float getRate() const { return valid ? rate : 0; }
+    float getConfidence() const { return confidence; }   // Normalised autocorrelation at the chosen lag
+};
+
+#endif
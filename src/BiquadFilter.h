@@ -0,0 +1,80 @@
+#ifndef BIQUAD_FILTER_H
+#define BIQUAD_FILTER_H
+
+#include <stddef.h>
+#include <math.h>
+
+// Second-order IIR section, transposed direct form II
+struct Biquad {
+    float b0 = 1, b1 = 0, b2 = 0;
+    float a1 = 0, a2 = 0;
+    float z1 = 0, z2 = 0;
+
+    // RBJ cookbook low-pass; q = 0.7071 gives a single Butterworth section
+    void designLowPass(float sampleRateHz, float cutoffHz, float q) {
+        float w0 = 2.0f * (float)M_PI * cutoffHz / sampleRateHz;
+        float cosW0 = cosf(w0);
+        float alpha = sinf(w0) / (2.0f * q);
+        float a0 = 1.0f + alpha;
+
+        b0 = (1.0f - cosW0) / 2.0f / a0;
+        b1 = (1.0f - cosW0) / a0;
+        b2 = b0;
+        a1 = -2.0f * cosW0 / a0;
+        a2 = (1.0f - alpha) / a0;
+        z1 = z2 = 0;
+    }
+
+    // Load the steady state for a constant input so the output starts at x
+    // instead of ringing up from zero (assumes unity DC gain)
+    void prime(float x) {
+        z1 = x * (1.0f - b0);
+        z2 = x * (b2 - a2);
+    }
+
+    float process(float x) {
+        float y = b0 * x + z1;
+        z1 = b1 * x - a1 * y + z2;
+        z2 = b2 * x - a2 * y;
+        return y;
+    }
+};
+
+// Cascade of up to MaxSections biquads forming an even-order Butterworth low-pass
+template <size_t MaxSections>
+class BiquadCascade {
+private:
+    Biquad sections[MaxSections];
+    size_t sectionCount;
+
+public:
+    BiquadCascade() : sectionCount(0) {}
+
+    // Order 2 * sectionCount Butterworth; sectionCount is clamped to MaxSections.
+    // Zero sections leaves the cascade as a pass-through.
+    void designLowPass(float sampleRateHz, float cutoffHz, size_t count) {
+        sectionCount = (count > MaxSections) ? MaxSections : count;
+        size_t order = 2 * sectionCount;
+        for (size_t k = 0; k < sectionCount; k++) {
+            float q = 1.0f / (2.0f * cosf((float)M_PI * (2 * k + 1) / (2.0f * order)));
+            sections[k].designLowPass(sampleRateHz, cutoffHz, q);
+        }
+    }
+
+    void prime(float x) {
+        for (size_t k = 0; k < sectionCount; k++) {
+            sections[k].prime(x);
+        }
+    }
+
+    float process(float x) {
+        for (size_t k = 0; k < sectionCount; k++) {
+            x = sections[k].process(x);
+        }
+        return x;
+    }
+
+    size_t size() const { return sectionCount; }
+};
+
+#endif
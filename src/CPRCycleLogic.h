@@ -0,0 +1,215 @@
+#ifndef CPR_CYCLE_LOGIC_H
+#define CPR_CYCLE_LOGIC_H
+
+#include <Arduino.h>
+#include "CPRMetricsCalculator.h"
+
+// Everything that happens once the front end has classified a sample: state
+// transitions, compression/recoil quality counts, the depth and recoil
+// windows, the median onset rate, CCF and alerts. CPRMetricsCalculator and
+// MultiChannelCPRCalculator both run this code, so a channel of the
+// multi-channel engine reports exactly what a single calculator would.
+//
+// Access is a small value type that resolves each field to a reference in the
+// owner's storage (members of one calculator, or column ch of the
+// multi-channel arrays):
+//   params()                                  const CPRThresholds&
+//   state(), lastStateChange(), lastAlertTime()
+//   activeTime(), cycleStartTime(), lastQuietudeEnterTime(), ccf(), cprCycles()
+//   validCycleStarted(), seenCompression(), seenRecoil()
+//   currentCompressionPeak(), currentRecoilMin(), lastCompressionWasOk()
+//   lastCompressionOnset(), compressionIntervals()   SlidingMedian
+//   depthPeaks(), recoilMins()                       RingBuffer
+//   goodCompressions(), totalCompressions(), goodRecoils(), incompleteRecoils(), totalRecoils()
+//   smoothedRate(), currentRate(), displayedRate(), lastValidRateTime(), alerts()
+// and the hooks for owner-specific extras (compression events, session
+// statistics, the autocorrelation rate source):
+//   bool hasEstimatedRate()                   Rate comes from elsewhere; onsets are the fallback
+//   void leaveState(newState, now)            Before state() changes to newState
+//   void compressionOnset(onsetTime, interval, firstOfRun)
+//   void compressionEnded(peak, peakOk)
+//   void recoilEnded(recoilMin, recoilOk)
+//   void noRecoil()                           A recoil phase ended without a tracked sample
+template <typename Access>
+struct CPRCycleLogic {
+    // Returns true if the event changed the state
+    static bool applyEvent(Access s, CPRTrendEvent event, float peakSmoothedValue,
+                           unsigned long onsetTime, unsigned long now) {
+        CPRState newState = cprNextState(s.state(), event);
+
+        bool stateChanged = (newState != s.state());
+        if (stateChanged) {
+            // Track time for CCF calculation
+            if (s.state() == CPRState::Compression || s.state() == CPRState::Recoil) {
+                s.activeTime() += now - s.lastStateChange();
+            } else if (s.cycleStartTime() == 0) {
+                s.cycleStartTime() = now; // Starting active period
+            }
+
+            // End previous state and handle compression quality
+            endState(s);
+            s.leaveState(newState, now);
+
+            s.state() = newState;
+            s.lastStateChange() = now;
+
+            // Handle entering new states for cycle tracking
+            switch (newState) {
+                case CPRState::Compression:
+                    if (s.lastCompressionOnset() != 0) {
+                        unsigned long interval = onsetTime - s.lastCompressionOnset();
+                        s.compressionOnset(onsetTime, interval, false);
+                        s.compressionIntervals().push(interval);
+                        updateRate(s, now);
+                    } else {
+                        s.compressionOnset(onsetTime, 0, true);
+                    }
+                    s.lastCompressionOnset() = onsetTime;
+                    s.seenCompression() = true;
+                    if (!s.validCycleStarted()) {
+                        s.validCycleStarted() = true;
+                        s.cycleStartTime() = now;
+                    }
+                    s.currentCompressionPeak() = peakSmoothedValue;
+                    s.totalCompressions()++;
+                    break;
+                case CPRState::Recoil:
+                    s.totalRecoils()++;
+                    s.seenRecoil() = true;
+                    s.currentRecoilMin() = peakSmoothedValue;
+                    break;
+                default:
+                    s.lastQuietudeEnterTime() = now;
+                    break;
+            }
+        }
+
+        // Check for cycle completion after 2 s of quietude
+        if (s.state() == CPRState::Quietude && s.lastQuietudeEnterTime() != 0 && s.validCycleStarted() &&
+            now - s.lastQuietudeEnterTime() >= 2000) {
+            if (s.seenCompression() && s.seenRecoil()) {
+                s.cprCycles()++;
+                unsigned long totalCycleTime = now - s.cycleStartTime();
+                if (totalCycleTime > 0) {
+                    s.ccf() = ((float)s.activeTime() / totalCycleTime) * 100.0;
+                }
+
+                // Reset for next cycle
+                s.cycleStartTime() = 0;
+                s.activeTime() = 0;
+                s.validCycleStarted() = false;
+            }
+
+            // Always reset flags after quietude
+            s.seenCompression() = false;
+            s.seenRecoil() = false;
+            s.lastQuietudeEnterTime() = 0;
+        }
+
+        // Peak/min tracking using peak detection values
+        if (s.state() == CPRState::Compression) {
+            s.currentCompressionPeak() = max(s.currentCompressionPeak(), peakSmoothedValue);
+        } else if (s.state() == CPRState::Recoil) {
+            s.currentRecoilMin() = min(s.currentRecoilMin(), peakSmoothedValue);
+        }
+
+        // Refresh alerts every second (rate itself updates on each compression onset)
+        if (now - s.lastAlertTime() >= 1000) {
+            generateAlerts(s);
+            s.lastAlertTime() = now;
+        }
+
+        return stateChanged;
+    }
+
+    static void endState(Access s) {
+        const CPRThresholds& params = s.params();
+
+        if (s.state() == CPRState::Compression) {
+            float peak = s.currentCompressionPeak();
+            bool peakOk = (params.c1 <= peak && peak <= params.c2);
+            s.depthPeaks().push(peak); // Oldest peak drops out once the window is full
+            s.lastCompressionWasOk() = peakOk;
+            s.compressionEnded(peak, peakOk);
+        } else if (s.state() == CPRState::Recoil) {
+            float recoilMin = s.currentRecoilMin();
+            if (recoilMin != 1023) {
+                bool recoilOk = (recoilMin <= params.r2);
+
+                if (recoilOk) {
+                    s.goodRecoils()++;
+                    if (s.lastCompressionWasOk()) {
+                        s.goodCompressions()++;
+                    }
+                } else {
+                    s.incompleteRecoils()++;
+                }
+
+                s.recoilMins().push(recoilMin); // Oldest recoil drops out once the window is full
+                s.recoilEnded(recoilMin, recoilOk);
+            } else {
+                s.noRecoil();
+            }
+        }
+
+        // Reset current peak/min values
+        s.currentCompressionPeak() = 0;
+        s.currentRecoilMin() = 1023;
+    }
+
+    static void updateRate(Access s, unsigned long now) {
+        if (s.hasEstimatedRate()) {
+            return;
+        }
+
+        // Median of the recent onset intervals, already maintained per push
+        float medianInterval = s.compressionIntervals().median() / 1000.0; // Convert to seconds
+        float clampedInterval = max(0.25f, min(medianInterval, 1.5f));
+        float rawRate = 60.0 / clampedInterval;
+
+        // Apply smoothing
+        float alpha = s.params().rateSmoothingFactor;
+        float& smoothedRate = s.smoothedRate();
+        smoothedRate = (smoothedRate == 0) ? rawRate : alpha * rawRate + (1 - alpha) * smoothedRate;
+
+        s.currentRate() = smoothedRate;
+        s.displayedRate() = round(smoothedRate);
+        s.lastValidRateTime() = now;
+    }
+
+    static void generateAlerts(Access s) {
+        const CPRThresholds& params = s.params();
+        CPRAlerts& alerts = s.alerts();
+        alerts.clear();
+
+        if (s.totalCompressions() == 0) {
+            alerts.set(CPRAlertCode::NoCompressions);
+        } else if (s.compressionIntervals().empty() && !s.hasEstimatedRate()) {
+            alerts.set(CPRAlertCode::NeedMoreCompressions);
+        } else if (s.currentRate() < params.f1) {
+            alerts.set(CPRAlertCode::RateTooLow);
+            alerts.rate = s.displayedRate();
+            alerts.rateLimit = params.f1;
+        } else if (s.currentRate() > params.f2) {
+            alerts.set(CPRAlertCode::RateTooHigh);
+            alerts.rate = s.displayedRate();
+            alerts.rateLimit = params.f2;
+        }
+
+        if (!s.depthPeaks().empty()) {
+            float avgPeak = s.depthPeaks().average();
+
+            if (avgPeak > params.c2) {
+                alerts.set(CPRAlertCode::DepthTooHigh);
+            } else if (avgPeak < params.c1) {
+                alerts.set(CPRAlertCode::DepthTooLow);
+            }
+        }
+
+        if (!s.recoilMins().empty() && s.recoilMins().average() > params.r2) {
+            alerts.set(CPRAlertCode::IncompleteRecoil);
+        }
+    }
+};
+
+#endif
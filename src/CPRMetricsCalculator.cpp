@@ -1,25 +1,90 @@
 #include "CPRMetricsCalculator.h"
+#include "CPRCycleLogic.h"
 #include <algorithm>
 #include <cmath>
 
-CPRMetricsCalculator::CPRMetricsCalculator() {
+namespace {
+
+constexpr size_t kStateCount = static_cast<size_t>(CPRState::Count);
+constexpr size_t kEventCount = static_cast<size_t>(CPRTrendEvent::Count);
+
+// kTransitions[current state][event] -> next state
+constexpr CPRState kTransitions[kStateCount][kEventCount] = {
+    // None                   Rising                 Falling             Settled
+    { CPRState::Quietude,    CPRState::Compression, CPRState::Recoil,   CPRState::Quietude }, // Quietude
+    { CPRState::Compression, CPRState::Compression, CPRState::Recoil,   CPRState::Quietude }, // Compression
+    { CPRState::Recoil,      CPRState::Compression, CPRState::Recoil,   CPRState::Quietude }, // Recoil
+};
+
+constexpr CPRState nextState(CPRState current, CPRTrendEvent event) {
+    return kTransitions[static_cast<size_t>(current)][static_cast<size_t>(event)];
+}
+
+static_assert(nextState(CPRState::Quietude, CPRTrendEvent::Rising) == CPRState::Compression,
+              "Transition table out of sync with CPRState/CPRTrendEvent ordering");
+static_assert(nextState(CPRState::Compression, CPRTrendEvent::None) == CPRState::Compression,
+              "Transition table out of sync with CPRState/CPRTrendEvent ordering");
+
+// Indexed by CPRAlertCode; rate messages take (rate, limit)
+const char* const ALERT_TEXT[] PROGMEM = {
+    "● No compressions detected",
+    "ℹ️ Need more compressions for rate",
+    "⚠️ CPR rate too low (%d < %d)",
+    "⚠️ CPR rate too high (%d > %d)",
+    "⬆️ Be gentle",
+    "⬇️ Press harder",
+    "🔼 Release more",
+};
+
+static_assert(sizeof(ALERT_TEXT) / sizeof(ALERT_TEXT[0]) == static_cast<size_t>(CPRAlertCode::Count),
+              "ALERT_TEXT out of sync with CPRAlertCode");
+
+} // namespace
+
+size_t formatAlert(CPRAlertCode code, const CPRAlerts& alerts, char* buffer, size_t size) {
+    if (code >= CPRAlertCode::Count || size == 0) {
+        return 0;
+    }
+    
+    int written = snprintf(buffer, size, ALERT_TEXT[static_cast<size_t>(code)], alerts.rate, alerts.rateLimit);
+    if (written < 0) {
+        buffer[0] = '\0';
+        return 0;
+    }
+    return min((size_t)written, size - 1);
+}
+
+CPRState cprNextState(CPRState current, CPRTrendEvent event) {
+    return nextState(current, event);
+}
+
+const char* cprStateToString(CPRState state) {
+    switch (state) {
+        case CPRState::Compression: return "compression";
+        case CPRState::Recoil:      return "recoil";
+        default:                    return "pause";
+    }
+}
+
+CPRMetricsCalculator::CPRMetricsCalculator()
+    : sessionDepth(0, 1024), sessionRecoil(0, 1024), sessionRate(0, 240) {
     reset();
 }
 
 // MODIFIED: Enhanced reset function to ensure complete metric reset
 void CPRMetricsCalculator::reset() {
-    state = "quietude";
+    state = CPRState::Quietude;
     lastStateChange = millis();
-    alertMessage.clear();
+    activeAlerts.clear();
     currentRate = 0;
     displayedRate = 0;
     lastValidRateTime = 0;
     
     // Clear all data containers
-    compressionPeaks.clear();
-    compressionIntervals.clear();
-    depthPeaks.clear();
-    recoilMins.clear();
+    compressionIntervals.setWindow(params.rateWindow);
+    lastCompressionOnset = 0;
+    depthPeaks.setCapacity(params.averagingWindow);
+    recoilMins.setCapacity(params.averagingWindow);
     
     // Reset all counters
     goodCompressions = 0;
@@ -27,16 +92,21 @@ void CPRMetricsCalculator::reset() {
     goodRecoils = 0;
     incompleteRecoils = 0;
     totalRecoils = 0;
-    
-    // Clear all history buffers
-    valueHistory.clear();
+    sessionDepth.clear();
+    sessionRecoil.clear();
+    sessionRate.clear();
+    compressionEvents.clear();
+    pendingCycle = CPRCompressionEvent();
+    cycleOpen = false;
+    
+    // Size and clear all history buffers from the current parameters
+    valueHistory.setCapacity(params.smoothingWindow);
     peakHistory.clear();
-    trendBuffer.clear();
-    peakTrendBuffer.clear();
+    trendBuffer.setCapacity(params.trendBufferSize);
     
     // Reset all processing variables
     previousSmoothValue = 0;
-    previousPeakValue = 0;
+    lastSmoothedValue = 0;
     lastPeakValue = 0;
     smoothedRate = 0;
     currentCompressionPeak = 0;
@@ -50,7 +120,6 @@ void CPRMetricsCalculator::reset() {
     cycleStartTime = 0;
     lastActiveTime = 0;
     activeTime = 0;
-    totalCycleTime = 0;
     ccf = 0;
     cprCycles = 0;
     lastQuietudeEnterTime = 0;
@@ -59,57 +128,143 @@ void CPRMetricsCalculator::reset() {
     seenRecoil = false;
     
     lastRateUpdateTime = 0;
+    lastSampleTime = 0;
+    
+    // Thresholds derived from params, fixed until the next reset
+    float operatingRange = params.c2 - params.r1;
+    quietudeThreshold = params.r1 + (params.quietudePercent * operatingRange);
+    minCompressionAmplitude = params.c1 * 0.5;
+    slopeMargin = params.hysteresisMargin * 1000; // Scale for ADC values
+    
+    extremaDetector.reset(params.peakProminence);
+    onsetArmed = false;
+    armedOnsetTime = 0;
+    
+    configureFrontEnd();
     
     // Log reset for debugging
     Serial.println("CPR Metrics Calculator: All metrics reset to initial state");
 }
 
 void CPRMetricsCalculator::updateParams(const CPRThresholds& newParams) {
-    params = newParams;
+    params = clampParams(newParams);
     reset(); // Reset to apply new parameters
 }
 
-CPRStatus CPRMetricsCalculator::detectTrend(float rawValue) {
-    if (!running) {
-        CPRStatus status;
-        status.state = state;
-        status.timestamp = millis();
-        return status;
+CPRThresholds CPRMetricsCalculator::clampParams(const CPRThresholds& requested) {
+    CPRThresholds clamped = requested;
+    clamped.smoothingWindow = max(1, min(requested.smoothingWindow, (int)MAX_SMOOTHING_WINDOW));
+    clamped.trendBufferSize = max(1, min(requested.trendBufferSize, (int)MAX_TREND_BUFFER_SIZE));
+    clamped.averagingWindow = max(1, min(requested.averagingWindow, (int)MAX_AVERAGING_WINDOW));
+    clamped.rateWindow = max(1, min(requested.rateWindow, (int)MAX_RATE_WINDOW));
+    clamped.featureRateHz = max(1, min(requested.featureRateHz, (int)MAX_SAMPLE_RATE_HZ));
+    clamped.sampleRateHz = max(clamped.featureRateHz, min(requested.sampleRateHz, (int)MAX_SAMPLE_RATE_HZ));
+    clamped.filterSections = max(0, min(requested.filterSections, (int)MAX_FILTER_SECTIONS));
+    return clamped;
+}
+
+void CPRMetricsCalculator::configureFrontEnd() {
+    int featureRate = max(1, params.featureRateHz);
+    int sampleRate = max(featureRate, min(params.sampleRateHz, (int)MAX_SAMPLE_RATE_HZ));
+    
+    decimationFactor = max(1, (int)lround((float)sampleRate / featureRate));
+    decimationCounter = 0;
+    filterPrimed = false;
+    sampleIntervalMicros = 1000000UL / sampleRate;
+    rateEstimator.configure(sampleRate / decimationFactor); // Runs on the state machine's samples
+    
+    if (decimationFactor == 1) {
+        inputFilter.designLowPass(sampleRate, 1, 0); // Pass-through
+        return;
     }
     
-    unsigned long now = millis();
-    lastPeakValue = max(lastPeakValue, rawValue);
+    // Keep the cutoff under the decimated Nyquist frequency to avoid aliasing
+    float cutoff = params.filterCutoffHz > 0 ? params.filterCutoffHz : 4.0f * params.f2 / 60.0f;
+    cutoff = min(cutoff, 0.4f * featureRate);
+    inputFilter.designLowPass(sampleRate, cutoff, max(0, params.filterSections));
     
-    // State detection using configured smoothing
-    valueHistory.push_back(rawValue);
-    if (valueHistory.size() > params.smoothingWindow) {
-        valueHistory.pop_front();
+    Serial.printf("CPR Metrics Calculator: high-rate mode %d Hz -> %d Hz, %.1f Hz cutoff, %d sections\n",
+                  sampleRate, sampleRate / decimationFactor, cutoff, (int)inputFilter.size());
+}
+
+bool CPRMetricsCalculator::detectTrendHighRate(float rawValue, unsigned long now, CPRSnapshot& snapshot) {
+    if (!running) {
+        return false;
     }
     
-    float smoothedValue = rawValue;
-    if (params.smoothingWindow > 1 && !valueHistory.empty()) {
-        float sum = 0;
-        for (float val : valueHistory) {
-            sum += val;
+    if (decimationFactor > 1) {
+        if (!filterPrimed) {
+            inputFilter.prime(rawValue);
+            filterPrimed = true;
+        }
+        rawValue = inputFilter.process(rawValue);
+        
+        if (++decimationCounter < decimationFactor) {
+            return false;
         }
-        smoothedValue = sum / valueHistory.size();
+        decimationCounter = 0;
     }
     
-    // Peak detection using light smoothing (max of 3 samples)
-    peakHistory.push_back(rawValue);
-    if (peakHistory.size() > 3) {
-        peakHistory.pop_front();
+    processSample(rawValue, now);
+    snapshot = buildSnapshot(now);
+    return true;
+}
+
+CPRSnapshot CPRMetricsCalculator::detectTrend(float rawValue) {
+    unsigned long now = millis();
+    
+    if (!running) {
+        CPRSnapshot snapshot;
+        snapshot.state = state;
+        snapshot.timestamp = now;
+        return snapshot;
     }
     
-    float peakSmoothedValue = rawValue;
-    if (!peakHistory.empty()) {
-        float sum = 0;
-        for (float val : peakHistory) {
-            sum += val;
+    processSample(rawValue, now);
+    return buildSnapshot(now);
+}
+
+size_t CPRMetricsCalculator::detectTrendBatch(const uint16_t* samples, const uint32_t* timestamps, size_t n,
+                                              CPRSnapshot* lastSnapshot,
+                                              CPRTransition* transitions, size_t maxTransitions) {
+    size_t transitionCount = 0;
+    
+    if (running) {
+        for (size_t i = 0; i < n; i++) {
+            CPRState previous = state;
+            if (processSample(samples[i], timestamps[i]) && transitionCount < maxTransitions) {
+                CPRTransition& t = transitions[transitionCount++];
+                t.timestamp = timestamps[i];
+                t.sampleIndex = i;
+                t.from = previous;
+                t.to = state;
+            }
         }
-        peakSmoothedValue = sum / peakHistory.size();
     }
     
+    if (lastSnapshot != nullptr) {
+        unsigned long now = (n > 0) ? timestamps[n - 1] : millis();
+        if (running) {
+            *lastSnapshot = buildSnapshot(now);
+        } else {
+            *lastSnapshot = CPRSnapshot();
+            lastSnapshot->state = state;
+            lastSnapshot->timestamp = now;
+        }
+    }
+    
+    return transitionCount;
+}
+
+bool CPRMetricsCalculator::processSample(float rawValue, unsigned long now) {
+    // State detection using configured smoothing
+    valueHistory.push(rawValue);
+    float smoothedValue = (params.smoothingWindow > 1) ? valueHistory.average() : rawValue;
+    
+    // Peak detection using light smoothing (average of 3 samples)
+    peakHistory.push(rawValue);
+    float peakSmoothedValue = peakHistory.average();
+    
     // State detection slope calculation
     float slope = 0;
     if (previousSmoothValue != 0) {
@@ -117,313 +272,267 @@ CPRStatus CPRMetricsCalculator::detectTrend(float rawValue) {
     }
     previousSmoothValue = smoothedValue;
     
-    // Peak detection slope calculation
-    float peakSlope = 0;
-    if (previousPeakValue != 0) {
-        peakSlope = peakSmoothedValue - previousPeakValue;
-    }
-    previousPeakValue = peakSmoothedValue;
-    
-    // Update trend buffers
-    trendBuffer.push_back(slope);
-    if (trendBuffer.size() > params.trendBufferSize) {
-        trendBuffer.pop_front();
+    trendBuffer.push(slope);
+    float avgSlope = trendBuffer.average();
+    
+    CPRTrendEvent event = CPRTrendEvent::None;
+    unsigned long onsetTime = now;
+    if (params.detectorMode == CPRDetectorMode::ZeroCrossing) {
+        event = classifyExtrema(rawValue, now, onsetTime);
+    } else if (avgSlope > slopeMargin && smoothedValue > minCompressionAmplitude) {
+        event = CPRTrendEvent::Rising;
+    } else if (avgSlope < -slopeMargin * 1.5) {
+        event = CPRTrendEvent::Falling;
+    } else if (smoothedValue <= quietudeThreshold) {
+        event = CPRTrendEvent::Settled;
     }
     
-    peakTrendBuffer.push_back(peakSlope);
-    if (peakTrendBuffer.size() > 3) {
-        peakTrendBuffer.pop_front();
+    return applyTrendEvent(event, rawValue, smoothedValue, peakSmoothedValue, onsetTime, now);
+}
+
+struct CPRMetricsCalculator::CycleAccess {
+    CPRMetricsCalculator& c;
+    
+    const CPRThresholds& params() const { return c.params; }
+    CPRState& state() const { return c.state; }
+    unsigned long& lastStateChange() const { return c.lastStateChange; }
+    unsigned long& lastAlertTime() const { return c.lastRateUpdateTime; }
+    unsigned long& activeTime() const { return c.activeTime; }
+    unsigned long& cycleStartTime() const { return c.cycleStartTime; }
+    unsigned long& lastQuietudeEnterTime() const { return c.lastQuietudeEnterTime; }
+    float& ccf() const { return c.ccf; }
+    int& cprCycles() const { return c.cprCycles; }
+    bool& validCycleStarted() const { return c.validCycleStarted; }
+    bool& seenCompression() const { return c.seenCompression; }
+    bool& seenRecoil() const { return c.seenRecoil; }
+    float& currentCompressionPeak() const { return c.currentCompressionPeak; }
+    float& currentRecoilMin() const { return c.currentRecoilMin; }
+    bool& lastCompressionWasOk() const { return c.lastCompressionWasOk; }
+    unsigned long& lastCompressionOnset() const { return c.lastCompressionOnset; }
+    SlidingMedian<unsigned long, MAX_RATE_WINDOW>& compressionIntervals() const { return c.compressionIntervals; }
+    RingBuffer<float, MAX_AVERAGING_WINDOW>& depthPeaks() const { return c.depthPeaks; }
+    RingBuffer<float, MAX_AVERAGING_WINDOW>& recoilMins() const { return c.recoilMins; }
+    int& goodCompressions() const { return c.goodCompressions; }
+    int& totalCompressions() const { return c.totalCompressions; }
+    int& goodRecoils() const { return c.goodRecoils; }
+    int& incompleteRecoils() const { return c.incompleteRecoils; }
+    int& totalRecoils() const { return c.totalRecoils; }
+    float& smoothedRate() const { return c.smoothedRate; }
+    int& currentRate() const { return c.currentRate; }
+    int& displayedRate() const { return c.displayedRate; }
+    unsigned long& lastValidRateTime() const { return c.lastValidRateTime; }
+    CPRAlerts& alerts() const { return c.activeAlerts; }
+    
+    bool hasEstimatedRate() const { return c.rateEstimator.hasEstimate(); }
+    
+    void leaveState(CPRState newState, unsigned long now) const {
+        // A cycle ends with its recoil, or with the compression if no recoil follows
+        if (c.cycleOpen && (c.state == CPRState::Recoil || newState != CPRState::Recoil)) {
+            c.closeCycle(now);
+        }
     }
     
-    float avgSlope = 0;
-    if (!trendBuffer.empty()) {
-        for (float s : trendBuffer) {
-            avgSlope += s;
+    void compressionOnset(unsigned long onsetTime, unsigned long interval, bool firstOfRun) const {
+        c.pendingCycle = CPRCompressionEvent();
+        c.pendingCycle.onsetTime = onsetTime;
+        c.cycleOpen = true;
+        if (firstOfRun) {
+            c.pendingCycle.set(CPRCompressionFlag::FirstOfRun);
+            return;
+        }
+        
+        c.pendingCycle.interval = interval;
+        const CPRThresholds& p = c.params;
+        if (p.f1 > 0 && p.f2 > 0 && interval >= 60000UL / p.f2 && interval <= 60000UL / p.f1) {
+            c.pendingCycle.set(CPRCompressionFlag::RateOk);
+        }
+        if (interval >= 250 && interval <= 1500) {
+            c.sessionRate.push(60000.0f / interval); // Pauses are not rate samples
         }
-        avgSlope /= trendBuffer.size();
     }
     
-    float avgPeakSlope = 0;
-    if (!peakTrendBuffer.empty()) {
-        for (float s : peakTrendBuffer) {
-            avgPeakSlope += s;
+    void compressionEnded(float peak, bool peakOk) const {
+        c.sessionDepth.push(peak);
+        c.lastCompressionPeak = peak;
+        c.pendingCycle.peakDepth = (uint16_t)lround(max(0.0f, peak));
+        if (peakOk) {
+            c.pendingCycle.set(CPRCompressionFlag::DepthOk);
+        } else {
+            c.pendingCycle.set(peak > c.params.c2 ? CPRCompressionFlag::DepthTooHigh :
+                                                    CPRCompressionFlag::DepthTooLow);
         }
-        avgPeakSlope /= peakTrendBuffer.size();
     }
     
-    float operatingRange = params.c2 - params.r1;
-    float quietudeThreshold = params.r1 + (params.quietudePercent * operatingRange);
-    float minCompressionAmplitude = params.c1 * 0.5;
-    float margin = params.hysteresisMargin * 1000; // Scale for ADC values
+    void recoilEnded(float recoilMin, bool recoilOk) const {
+        c.sessionRecoil.push(recoilMin);
+        c.pendingCycle.recoilMin = (uint16_t)lround(max(0.0f, recoilMin));
+        c.pendingCycle.set(recoilOk ? CPRCompressionFlag::RecoilOk : CPRCompressionFlag::RecoilIncomplete);
+    }
     
-    String newState = state;
+    void noRecoil() const {
+        // No recoil sample was tracked: not a recoil at all, rather than a failed one
+        c.pendingCycle.set(CPRCompressionFlag::NoRecoil);
+    }
+};
+
+bool CPRMetricsCalculator::applyTrendEvent(CPRTrendEvent event, float rawValue, float smoothedValue,
+                                           float peakSmoothedValue, unsigned long onsetTime, unsigned long now) {
+    lastSampleTime = now;
+    lastPeakValue = max(lastPeakValue, rawValue);
+    lastSmoothedValue = smoothedValue;
     
-    // State transitions based on smoothed values
-    if (avgSlope > margin && smoothedValue > minCompressionAmplitude) {
-        newState = "compression";
-        if (state != "compression") {
-            compressionPeaks.push_back(now);
-        }
-    } else if (avgSlope < -margin * 1.5) {
-        newState = "recoil";
-        if (state != "recoil") {
-            totalRecoils++;
-        }
-    } else if (smoothedValue <= quietudeThreshold) {
-        newState = "quietude";
+    if (params.rateSource == CPRRateSource::Autocorrelation && rateEstimator.push(rawValue)) {
+        updateEstimatedRate(now);
     }
     
-    // Track active time continuously during compression/recoil
-    //if (state == "compression" || state == "recoil") {
-    //    if (lastActiveTime != 0) {
-    //        activeTime += now - lastActiveTime;
-    //    }
-    //    lastActiveTime = now;
-    //} else {
-    //    lastActiveTime = 0;
-    //}
-    
-    // Handle state transitions and cycle logic
-    if (newState != state) {
-        // Track time for CCF calculation
-        if (state == "compression" || state == "recoil") {
-            activeTime += now - lastStateChange;
-        } else if (state == "quietude" && newState != "quietude") {
-            // Starting active period
-            if (cycleStartTime == 0) {
-                cycleStartTime = now;
+    return CPRCycleLogic<CycleAccess>::applyEvent(CycleAccess{*this}, event, peakSmoothedValue, onsetTime, now);
+}
+
+CPRTrendEvent CPRMetricsCalculator::classifyExtrema(float rawValue, unsigned long now, unsigned long& onsetTime) {
+    Extremum extremum;
+    if (extremaDetector.push(rawValue, now, extremum)) {
+        if (extremum.isPeak) {
+            // Peak reached: the compression ends at the interpolated vertex
+            if (state == CPRState::Compression) {
+                currentCompressionPeak = extremum.amplitude;
             }
+            return CPRTrendEvent::Falling;
         }
         
-        // End previous state and handle compression quality
-        endState();
-        
-        // Update state
-        state = newState;
-        lastStateChange = now;
-        
-        // Handle entering new states for cycle tracking
-        if (newState == "compression") {
-            seenCompression = true;
-            if (!validCycleStarted) {
-                validCycleStarted = true;
-                cycleStartTime = now;
+        // Trough reached: this is where the next compression starts
+        onsetArmed = true;
+        armedOnsetTime = extremum.time;
+        if (state == CPRState::Recoil) {
+            currentRecoilMin = extremum.amplitude;
+            if (extremum.amplitude <= quietudeThreshold && rawValue <= minCompressionAmplitude) {
+                return CPRTrendEvent::Settled;
             }
-            currentCompressionPeak = peakSmoothedValue;
-            totalCompressions++;
-        } else if (newState == "recoil") {
-            seenRecoil = true;
-            currentRecoilMin = peakSmoothedValue;
-        } else if (newState == "quietude") {
-            lastQuietudeEnterTime = now;
         }
     }
     
-    // Check for cycle completion during quietude
-    if (state == "quietude" && lastQuietudeEnterTime != 0 && validCycleStarted) {
-        unsigned long quietudeDuration = now - lastQuietudeEnterTime;
-        
-        if (quietudeDuration >= 2000) { // 2 seconds
-            if (seenCompression && seenRecoil) {
-                // Complete the cycle
-                cprCycles++;
-                totalCycleTime = now - cycleStartTime;
-                if (totalCycleTime > 0) {
-                    ccf = ((float)activeTime / totalCycleTime) * 100.0;
-                }
-                
-                // Reset for next cycle
-                cycleStartTime = 0;
-                activeTime = 0;
-                totalCycleTime = 0;
-                validCycleStarted = false;
-            }
-            
-            // Always reset flags after quietude
-            seenCompression = false;
-            seenRecoil = false;
-            lastQuietudeEnterTime = 0;
-        }
+    // Count the compression once it is deep enough, timed from its trough
+    if (onsetArmed && rawValue > minCompressionAmplitude) {
+        onsetArmed = false;
+        onsetTime = armedOnsetTime;
+        return CPRTrendEvent::Rising;
     }
     
-    // Peak/min tracking using peak detection values
-    if (state == "compression") {
-        currentCompressionPeak = max(currentCompressionPeak, peakSmoothedValue);
-    } else if (state == "recoil") {
-        currentRecoilMin = min(currentRecoilMin, peakSmoothedValue);
+    // Flat at the bottom with no confirmed trough (paused hands)
+    if (state == CPRState::Recoil && rawValue <= quietudeThreshold &&
+        !extremaDetector.isSeekingPeak() && now - extremaDetector.getCandidateTime() >= QUIET_TROUGH_HOLD_MS) {
+        return CPRTrendEvent::Settled;
     }
     
-    // Update rate and depth every second
-    if (now - lastRateUpdateTime >= 1000) {
-        updateRateAndDepth(now);
-        lastRateUpdateTime = now;
-    }
-    
-    // Prepare and return status
+    return CPRTrendEvent::None;
+}
+
+CPRSnapshot CPRMetricsCalculator::buildSnapshot(unsigned long now) const {
+    CPRSnapshot snapshot;
+    snapshot.timestamp = now;
+    snapshot.state = state;
+    snapshot.currentRate = displayedRate;
+    snapshot.rawValue = lastSmoothedValue;
+    snapshot.ccf = ccf;
+    snapshot.currentCompression = getCurrentCompression();
+    snapshot.currentRecoil = getCurrentRecoil();
+    snapshot.alerts = activeAlerts;
+    return snapshot;
+}
+
+CPRStatus CPRMetricsCalculator::getStatus() const {
     CPRStatus status;
-    status.state = (state == "quietude") ? "pause" : state;
+    status.state = state;
     status.currentRate = displayedRate;
-    status.alerts = alertMessage;
-    status.rawValue = smoothedValue;
+    status.alerts = activeAlerts;
+    status.rawValue = lastSmoothedValue;
     status.peakValue = lastPeakValue;
     status.thresholds = params;
-    status.timestamp = now;
-    
-    // Metrics
-    status.peaks.good = goodCompressions;
-    status.peaks.total = totalCompressions;
-    status.peaks.ratio = (totalCompressions > 0) ? (float)goodCompressions / totalCompressions : 0;
-    status.peaks.isGood = (state == "compression") ? 
-        (params.c1 <= currentCompressionPeak && currentCompressionPeak <= params.c2) : false;
-    
-    if (!depthPeaks.empty()) {
-        float sum = 0;
-        for (float peak : depthPeaks) {
-            sum += peak;
-        }
-        status.peaks.average = sum / depthPeaks.size();
-    }
-    
-    status.troughs.goodRecoil = goodRecoils;
-    status.troughs.incompleteRecoil = incompleteRecoils;
-    status.troughs.total = totalRecoils;
-    status.troughs.ratio = (totalRecoils > 0) ? (float)goodRecoils / totalRecoils : 0;
-    
+    status.timestamp = lastSampleTime;
+    status.peaks = getCompressionMetrics();
+    status.troughs = getRecoilMetrics();
     status.ccf = ccf;
     status.cycles = cprCycles;
-    
-    status.currentCompression.peakValue = currentCompressionPeak;
-    status.currentCompression.isGood = (state == "compression") ? 
+    status.currentCompression = getCurrentCompression();
+    status.currentRecoil = getCurrentRecoil();
+    return status;
+}
+
+CompressionMetrics CPRMetricsCalculator::getCompressionMetrics() const {
+    CompressionMetrics metrics;
+    metrics.good = goodCompressions;
+    metrics.total = totalCompressions;
+    metrics.ratio = (totalCompressions > 0) ? (float)goodCompressions / totalCompressions : 0;
+    metrics.isGood = (state == CPRState::Compression) ? 
         (params.c1 <= currentCompressionPeak && currentCompressionPeak <= params.c2) : false;
-    
-    status.currentRecoil.minValue = (currentRecoilMin != 1023) ? currentRecoilMin : 0;
-    status.currentRecoil.isGood = (state == "recoil" && currentRecoilMin != 1023) ? 
+    metrics.average = depthPeaks.average();
+    return metrics;
+}
+
+CPRSessionSummary CPRMetricsCalculator::getSessionSummary() const {
+    CPRSessionSummary summary;
+    summary.depth = sessionDepth.summary();
+    summary.recoil = sessionRecoil.summary();
+    summary.rate = sessionRate.summary();
+    summary.goodCompressions = goodCompressions;
+    summary.totalCompressions = totalCompressions;
+    return summary;
+}
+
+RecoilMetrics CPRMetricsCalculator::getRecoilMetrics() const {
+    RecoilMetrics metrics;
+    metrics.goodRecoil = goodRecoils;
+    metrics.incompleteRecoil = incompleteRecoils;
+    metrics.total = totalRecoils;
+    metrics.ratio = (totalRecoils > 0) ? (float)goodRecoils / totalRecoils : 0;
+    return metrics;
+}
+
+CurrentCompression CPRMetricsCalculator::getCurrentCompression() const {
+    CurrentCompression current;
+    current.peakValue = currentCompressionPeak;
+    current.isGood = (state == CPRState::Compression) ? 
+        (params.c1 <= currentCompressionPeak && currentCompressionPeak <= params.c2) : false;
+    return current;
+}
+
+CurrentRecoil CPRMetricsCalculator::getCurrentRecoil() const {
+    CurrentRecoil current;
+    current.minValue = (currentRecoilMin != 1023) ? currentRecoilMin : 0;
+    current.isGood = (state == CPRState::Recoil && currentRecoilMin != 1023) ? 
         (currentRecoilMin <= params.r2) : false;
-    
-    return status;
+    return current;
 }
 
 void CPRMetricsCalculator::endState() {
-    if (state == "compression") {
-        bool peakOk = (params.c1 <= currentCompressionPeak && currentCompressionPeak <= params.c2);
-        depthPeaks.push_back(currentCompressionPeak);
-        lastCompressionPeak = currentCompressionPeak;
-        lastCompressionWasOk = peakOk;
-        
-        // Keep only recent peaks (last 100)
-        if (depthPeaks.size() > 100) {
-            depthPeaks.erase(depthPeaks.begin());
-        }
-    } else if (state == "recoil") {
-        if (currentRecoilMin != 1023) {
-            bool recoilOk = (currentRecoilMin <= params.r2);
-            
-            if (recoilOk) {
-                goodRecoils++;
-                if (lastCompressionWasOk) {
-                    goodCompressions++;
-                }
-            } else {
-                incompleteRecoils++;
-            }
-            
-            recoilMins.push_back(currentRecoilMin);
-            
-            // Keep only recent recoils (last 100)
-            if (recoilMins.size() > 100) {
-                recoilMins.erase(recoilMins.begin());
-            }
-        }
-    }
-    
-    // Reset current peak/min values
-    currentCompressionPeak = 0;
-    currentRecoilMin = 1023;
+    CPRCycleLogic<CycleAccess>::endState(CycleAccess{*this});
 }
 
-void CPRMetricsCalculator::updateRateAndDepth(unsigned long now) {
-    try {
-        // Keep only recent compression peaks (last 10)
-        if (compressionPeaks.size() > 10) {
-            compressionPeaks.erase(compressionPeaks.begin(), compressionPeaks.end() - 10);
-        }
-        
-        // Calculate rate
-        if (compressionPeaks.size() >= 2) {
-            std::vector<float> intervals;
-            for (size_t i = 1; i < compressionPeaks.size(); i++) {
-                float interval = (compressionPeaks[i] - compressionPeaks[i-1]) / 1000.0; // Convert to seconds
-                intervals.push_back(interval);
-            }
-            
-            // Get median interval
-            std::sort(intervals.begin(), intervals.end());
-            float medianInterval = intervals[intervals.size() / 2];
-            float clampedInterval = max(0.25f, min(medianInterval, 1.5f));
-            float rawRate = 60.0 / clampedInterval;
-            
-            // Apply smoothing
-            float alpha = params.rateSmoothingFactor;
-            smoothedRate = (smoothedRate == 0) ? rawRate : alpha * rawRate + (1 - alpha) * smoothedRate;
-            
-            currentRate = smoothedRate;
-            displayedRate = round(smoothedRate);
-            lastValidRateTime = now;
-        } else {
-            displayedRate = 0;
-        }
-        
-        generateAlerts();
-        
-    } catch (...) {
-        alertMessage.clear();
-        alertMessage.push_back("⚠️ Rate calculation error");
-        reset();
+void CPRMetricsCalculator::closeCycle(unsigned long now) {
+    // Called before the state changes: still in Compression means no recoil phase
+    if (state != CPRState::Recoil) {
+        pendingCycle.set(CPRCompressionFlag::NoRecoil);
     }
+    pendingCycle.duration = (uint16_t)min(now - pendingCycle.onsetTime, 65535UL);
+    compressionEvents.push(pendingCycle);
+    cycleOpen = false;
 }
 
-void CPRMetricsCalculator::generateAlerts() {
-    alertMessage.clear();
-    
-    int f1 = params.f1;
-    int f2 = params.f2;
-    int c1 = params.c1;
-    int c2 = params.c2;
-    int r2 = params.r2;
-    
-    if (compressionPeaks.empty()) {
-        alertMessage.push_back("● No compressions detected");
-    } else if (compressionPeaks.size() < 2) {
-        alertMessage.push_back("ℹ️ Need more compressions for rate");
-    } else if (currentRate < f1) {
-        alertMessage.push_back("⚠️ CPR rate too low (" + String(displayedRate) + " < " + String(f1) + ")");
-    } else if (currentRate > f2) {
-        alertMessage.push_back("⚠️ CPR rate too high (" + String(displayedRate) + " > " + String(f2) + ")");
-    }
-    
-    if (!depthPeaks.empty()) {
-        float sum = 0;
-        for (float peak : depthPeaks) {
-            sum += peak;
-        }
-        float avgPeak = sum / depthPeaks.size();
-        
-        if (avgPeak > c2) {
-            alertMessage.push_back("⬆️ Be gentle");
-        } else if (avgPeak < c1) {
-            alertMessage.push_back("⬇️ Press harder");
-        }
+void CPRMetricsCalculator::updateRate(unsigned long now) {
+    CPRCycleLogic<CycleAccess>::updateRate(CycleAccess{*this}, now);
+}
+
+void CPRMetricsCalculator::updateEstimatedRate(unsigned long now) {
+    if (!rateEstimator.hasEstimate()) {
+        return; // Keep the last rate; onset intervals take over until it locks again
     }
     
-    if (!recoilMins.empty()) {
-        float sum = 0;
-        for (float recoil : recoilMins) {
-            sum += recoil;
-        }
-        float avgRecoil = sum / recoilMins.size();
-        
-        if (avgRecoil > r2) {
-            alertMessage.push_back("🔼 Release more");
-        }
-    }
-}
\ No newline at end of file
+    // Already smoothed by the estimator; seed the onset EMA so a fallback is seamless
+    smoothedRate = rateEstimator.getRate();
+    currentRate = smoothedRate;
+    displayedRate = round(smoothedRate);
+    lastValidRateTime = now;
+}
+
+void CPRMetricsCalculator::generateAlerts() {
+    CPRCycleLogic<CycleAccess>::generateAlerts(CycleAccess{*this});
+}
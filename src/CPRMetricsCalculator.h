@@ -2,8 +2,74 @@
 #define CPR_METRICS_CALCULATOR_H
 
 #include <Arduino.h>
-#include <vector>
-#include <deque>
+#include "RingBuffer.h"
+#include "SlidingMedian.h"
+#include "BiquadFilter.h"
+#include "PeakDetector.h"
+#include "AutocorrelationRateEstimator.h"
+#include "StreamingStats.h"
+
+enum class CPRState : uint8_t {
+    Quietude = 0,
+    Compression,
+    Recoil,
+    Count
+};
+
+// Classification of a single sample, fed into the state transition table
+enum class CPRTrendEvent : uint8_t {
+    None = 0,   // No decisive movement, hold current state
+    Rising,     // Compression under way with enough amplitude
+    Falling,    // Release under way
+    Settled,    // Signal back under the quietude threshold
+    Count
+};
+
+// Shared state transition table lookup (also used by the multi-channel engine)
+CPRState cprNextState(CPRState current, CPRTrendEvent event);
+
+// String form used at the JSON/CSV edges. Quietude is reported as "pause".
+const char* cprStateToString(CPRState state);
+
+// Feedback alerts, in the order they are reported to the dashboard
+enum class CPRAlertCode : uint8_t {
+    NoCompressions = 0,
+    NeedMoreCompressions,
+    RateTooLow,
+    RateTooHigh,
+    DepthTooHigh,       // "Be gentle"
+    DepthTooLow,        // "Press harder"
+    IncompleteRecoil,   // "Release more"
+    Count
+};
+
+// Active alerts as a bitmask plus the numbers the rate messages quote.
+// Text is only rendered on demand through formatAlert().
+struct CPRAlerts {
+    uint16_t mask = 0;
+    int rate = 0;       // Displayed rate when the rate alert was raised
+    int rateLimit = 0;  // Threshold it was compared against (f1 or f2)
+    
+    void clear() { mask = 0; }
+    void set(CPRAlertCode code) { mask |= (uint16_t)(1u << static_cast<uint8_t>(code)); }
+    bool has(CPRAlertCode code) const { return mask & (1u << static_cast<uint8_t>(code)); }
+    bool empty() const { return mask == 0; }
+};
+
+// Renders the dashboard text for one alert into buffer. Returns the length written.
+size_t formatAlert(CPRAlertCode code, const CPRAlerts& alerts, char* buffer, size_t size);
+
+// How compression onsets and peaks are found
+enum class CPRDetectorMode : uint8_t {
+    Slope = 0,          // Averaged slope crossing a margin (original detector)
+    ZeroCrossing        // Derivative sign change + parabolic interpolation
+};
+
+// Where the displayed rate comes from
+enum class CPRRateSource : uint8_t {
+    Onsets = 0,         // Median onset-to-onset interval, updated per compression
+    Autocorrelation     // Periodicity of the sample stream, onsets as fallback
+};
 
 struct CPRThresholds {
     int r1 = 200;  // Recoil low value
@@ -19,6 +85,20 @@ struct CPRThresholds {
     float compressionGracePeriod = 0.1;
     float hysteresisMargin = 0.01;
     int trendBufferSize = 3;
+    int averagingWindow = 100;  // Compressions/recoils kept for depth and recoil averages
+    int rateWindow = 9;         // Onset-to-onset intervals in the median rate window
+    
+    // High-rate acquisition: when sampleRateHz exceeds featureRateHz, samples go
+    // through a Butterworth low-pass and are decimated down to featureRateHz
+    int sampleRateHz = 40;      // ADC sampling rate (clamped to 1000)
+    int featureRateHz = 40;     // Rate the state machine and windows are tuned for
+    float filterCutoffHz = 0;   // 0 = derive from f2 (four harmonics of the max CPR rate)
+    int filterSections = 2;     // Biquad sections (filter order = 2 x sections)
+    
+    CPRDetectorMode detectorMode = CPRDetectorMode::Slope;
+    float peakProminence = 30;  // ZeroCrossing: retreat (ADC units) that confirms a peak/trough
+    
+    CPRRateSource rateSource = CPRRateSource::Onsets;
 };
 
 struct CompressionMetrics {
@@ -47,35 +127,118 @@ struct CurrentRecoil {
 };
 
 struct CPRStatus {
-    String state;
-    int currentRate;
-    std::vector<String> alerts;
-    float rawValue;
-    float peakValue;
+    CPRState state = CPRState::Quietude;
+    int currentRate = 0;
+    CPRAlerts alerts;
+    float rawValue = 0;
+    float peakValue = 0;
     CPRThresholds thresholds;
-    unsigned long timestamp;
+    unsigned long timestamp = 0;
     CompressionMetrics peaks;
     RecoilMetrics troughs;
-    float ccf;
-    int cycles;
+    float ccf = 0;
+    int cycles = 0;
+    CurrentCompression currentCompression;
+    CurrentRecoil currentRecoil;
+};
+
+// Compact per-sample output of detectTrend(). Aggregates (averages, ratios,
+// thresholds) are left to the on-demand accessors and getStatus().
+struct CPRSnapshot {
+    unsigned long timestamp = 0;
+    CPRState state = CPRState::Quietude;
+    int currentRate = 0;
+    float rawValue = 0;
+    float ccf = 0;
     CurrentCompression currentCompression;
     CurrentRecoil currentRecoil;
+    CPRAlerts alerts;
 };
 
+// State change reported by detectTrendBatch()
+struct CPRTransition {
+    uint32_t timestamp;
+    size_t sampleIndex;     // Index into the batch that caused the change
+    CPRState from;
+    CPRState to;
+};
+
+// Quality of one compression cycle, as bits of CPRCompressionEvent::flags
+enum class CPRCompressionFlag : uint8_t {
+    DepthOk = 0,        // c1 <= peak <= c2
+    DepthTooHigh,
+    DepthTooLow,
+    RecoilOk,           // Recoil minimum <= r2
+    NoRecoil,           // No recoil phase, or one without a tracked minimum
+    RateOk,             // Interval since the previous onset within f1..f2
+    FirstOfRun,         // No previous onset to measure an interval from
+    RecoilIncomplete,   // Recoil minimum > r2
+    Count
+};
+
+// Every event carries exactly one of RecoilOk, RecoilIncomplete and NoRecoil
+static_assert(static_cast<size_t>(CPRCompressionFlag::Count) <= 8, "CPRCompressionEvent::flags is 8 bits");
+
+// One completed compression/recoil cycle, emitted once the recoil (or the
+// compression, if no recoil followed) ends. Timestamps are the calculator's
+// sample times in ms.
+struct CPRCompressionEvent {
+    uint32_t onsetTime = 0;
+    uint32_t interval = 0;      // ms since the previous onset, 0 if FirstOfRun
+    uint16_t duration = 0;      // ms from onset to the end of the cycle
+    uint16_t peakDepth = 0;     // Calculator units
+    uint16_t recoilMin = 0;     // Calculator units, 0 if NoRecoil
+    uint8_t flags = 0;
+    
+    void set(CPRCompressionFlag flag) { flags |= (uint8_t)(1u << static_cast<uint8_t>(flag)); }
+    bool has(CPRCompressionFlag flag) const { return flags & (1u << static_cast<uint8_t>(flag)); }
+    bool isGood() const { return has(CPRCompressionFlag::DepthOk) && has(CPRCompressionFlag::RecoilOk); }
+};
+
+// Whole-session distributions, available at any time without keeping samples
+struct CPRSessionSummary {
+    DistributionSummary depth;   // Compression peaks (calculator units)
+    DistributionSummary recoil;  // Recoil minima (calculator units)
+    DistributionSummary rate;    // Per-interval rate (compressions/min)
+    int goodCompressions = 0;
+    int totalCompressions = 0;
+};
+
+template <typename Config> class FixedCPRMetricsCalculator;
+
 class CPRMetricsCalculator {
+    // Compile-time front end that reuses the state/bookkeeping step
+    template <typename Config> friend class FixedCPRMetricsCalculator;
+    // bench/cpr_bench.cpp times the private per-transition steps directly
+    friend struct CPRMetricsBench;
+
+public:
+    // Upper bounds for the configurable windows (storage is reserved inline)
+    static constexpr size_t MAX_SMOOTHING_WINDOW = 32;
+    static constexpr size_t MAX_TREND_BUFFER_SIZE = 32;
+    static constexpr size_t PEAK_WINDOW = 3;
+    static constexpr size_t MAX_AVERAGING_WINDOW = 512;
+    static constexpr size_t MAX_RATE_WINDOW = 32;
+    static constexpr size_t MAX_FILTER_SECTIONS = 4;
+    static constexpr int MAX_SAMPLE_RATE_HZ = 1000;
+    static constexpr unsigned long QUIET_TROUGH_HOLD_MS = 250;
+    static constexpr size_t DEPTH_HISTOGRAM_BINS = 64;   // 16 units per bin over 0-1023
+    static constexpr size_t RATE_HISTOGRAM_BINS = 48;    // 5 cpm per bin over 0-240
+    static constexpr size_t EVENT_QUEUE_SIZE = 16;       // ~8 s of compressions between drains
+
 private:
     CPRThresholds params;
-    String state;
+    CPRState state;
     unsigned long lastStateChange;
-    std::vector<String> alertMessage;
+    CPRAlerts activeAlerts;
     int currentRate;
     int displayedRate;
     unsigned long lastValidRateTime;
     
-    std::vector<unsigned long> compressionPeaks;
-    std::vector<unsigned long> compressionIntervals;
-    std::vector<float> depthPeaks;
-    std::vector<float> recoilMins;
+    SlidingMedian<unsigned long, MAX_RATE_WINDOW> compressionIntervals;
+    unsigned long lastCompressionOnset;
+    RingBuffer<float, MAX_AVERAGING_WINDOW> depthPeaks;
+    RingBuffer<float, MAX_AVERAGING_WINDOW> recoilMins;
     
     int goodCompressions;
     int totalCompressions;
@@ -83,13 +246,28 @@ private:
     int incompleteRecoils;
     int totalRecoils;
     
-    std::deque<float> valueHistory;
-    std::deque<float> peakHistory;
-    std::deque<float> trendBuffer;
-    std::deque<float> peakTrendBuffer;
+    // Completed cycles waiting for popCompressionEvent(); the open cycle is
+    // built up in pendingCycle from onset to the end of its recoil
+    EventQueue<CPRCompressionEvent, EVENT_QUEUE_SIZE> compressionEvents;
+    CPRCompressionEvent pendingCycle;
+    bool cycleOpen;
+    
+    // Whole-session distributions (constant memory, updated per compression)
+    SessionDistribution<DEPTH_HISTOGRAM_BINS> sessionDepth;
+    SessionDistribution<DEPTH_HISTOGRAM_BINS> sessionRecoil;
+    SessionDistribution<RATE_HISTOGRAM_BINS> sessionRate;
+    
+    RingBuffer<float, MAX_SMOOTHING_WINDOW> valueHistory;
+    RingBuffer<float, PEAK_WINDOW> peakHistory;
+    RingBuffer<float, MAX_TREND_BUFFER_SIZE> trendBuffer;
+    
+    // Derived from params in reset() instead of per sample
+    float quietudeThreshold;
+    float minCompressionAmplitude;
+    float slopeMargin;
     
     float previousSmoothValue;
-    float previousPeakValue;
+    float lastSmoothedValue;
     float lastPeakValue;
     float smoothedRate;
     float currentCompressionPeak;
@@ -103,7 +281,6 @@ private:
     unsigned long cycleStartTime;
     unsigned long lastActiveTime;
     unsigned long activeTime;
-    unsigned long totalCycleTime;
     float ccf;
     int cprCycles;
     unsigned long lastQuietudeEnterTime;
@@ -112,16 +289,92 @@ private:
     bool seenRecoil;
     
     unsigned long lastRateUpdateTime;
+    unsigned long lastSampleTime;
+    
+    // High-rate front end
+    BiquadCascade<MAX_FILTER_SECTIONS> inputFilter;
+    int decimationFactor;
+    int decimationCounter;
+    bool filterPrimed;
+    unsigned long sampleIntervalMicros;
+    
+    void configureFrontEnd();
+    
+    // Zero-crossing detector state
+    PeakDetector extremaDetector;
+    bool onsetArmed;
+    unsigned long armedOnsetTime;
+    
+    // Autocorrelation rate source (fed only when selected)
+    AutocorrelationRateEstimator rateEstimator;
     
+    // Resolves CPRCycleLogic's fields to this calculator's members
+    struct CycleAccess;
+    
+    CPRTrendEvent classifyExtrema(float rawValue, unsigned long now, unsigned long& onsetTime);
+    bool processSample(float rawValue, unsigned long now);
+    bool applyTrendEvent(CPRTrendEvent event, float rawValue, float smoothedValue,
+                         float peakSmoothedValue, unsigned long onsetTime, unsigned long now);
+    CPRSnapshot buildSnapshot(unsigned long now) const;
     void endState();
-    void updateRateAndDepth(unsigned long now);
+    void closeCycle(unsigned long now);
+    void updateRate(unsigned long now);
+    void updateEstimatedRate(unsigned long now);
     void generateAlerts();
 
 public:
     CPRMetricsCalculator();
     void reset();
+    // Stores clampParams(newParams), so getStatus().thresholds is what runs
     void updateParams(const CPRThresholds& newParams);
-    CPRStatus detectTrend(float rawValue);
+    CPRSnapshot detectTrend(float rawValue);
+    
+    // The windows and front-end settings limited to what the inline storage
+    // and the filter allow
+    static CPRThresholds clampParams(const CPRThresholds& requested);
+    
+    // Process a block of samples (calculator units, 0-1023) in one pass using
+    // the supplied timestamps instead of millis(). Only the snapshot after the
+    // last sample is built (into lastSnapshot, if given); state changes are
+    // written to transitions[] up to maxTransitions. Returns the number written.
+    size_t detectTrendBatch(const uint16_t* samples, const uint32_t* timestamps, size_t n,
+                            CPRSnapshot* lastSnapshot = nullptr,
+                            CPRTransition* transitions = nullptr, size_t maxTransitions = 0);
+    
+    // High-rate entry point: filters every sample and runs the state machine on
+    // every decimationFactor-th one. Returns true (and fills snapshot) only for
+    // those feature-rate samples. With sampleRateHz == featureRateHz this is
+    // detectTrend() with an explicit timestamp.
+    bool detectTrendHighRate(float rawValue, unsigned long now, CPRSnapshot& snapshot);
+    bool isHighRateMode() const { return decimationFactor > 1; }
+    int getDecimationFactor() const { return decimationFactor; }
+    unsigned long getSampleIntervalMicros() const { return sampleIntervalMicros; }
+    
+    // On-demand aggregates, computed from the running state when called
+    CPRStatus getStatus() const;
+    CompressionMetrics getCompressionMetrics() const;
+    RecoilMetrics getRecoilMetrics() const;
+    CurrentCompression getCurrentCompression() const;
+    CurrentRecoil getCurrentRecoil() const;
+    float getAverageDepth() const { return depthPeaks.average(); }
+    float getAverageRecoil() const { return recoilMins.average(); }
+    CPRSessionSummary getSessionSummary() const;
+    
+    // Per-compression stream: one record per completed cycle, oldest first.
+    // Drain it from the same task that feeds samples; records beyond
+    // EVENT_QUEUE_SIZE undrained are dropped (oldest first).
+    bool popCompressionEvent(CPRCompressionEvent& event) { return compressionEvents.pop(event); }
+    size_t getPendingCompressionEvents() const { return compressionEvents.size(); }
+    size_t getDroppedCompressionEvents() const { return compressionEvents.dropped(); }
+    const Histogram<DEPTH_HISTOGRAM_BINS>& getDepthHistogram() const { return sessionDepth.getHistogram(); }
+    const Histogram<DEPTH_HISTOGRAM_BINS>& getRecoilHistogram() const { return sessionRecoil.getHistogram(); }
+    const Histogram<RATE_HISTOGRAM_BINS>& getRateHistogram() const { return sessionRate.getHistogram(); }
+    int getRate() const { return displayedRate; }
+    CPRRateSource getRateSource() const { return params.rateSource; }
+    float getRateConfidence() const { return rateEstimator.getConfidence(); }
+    float getCCF() const { return ccf; }
+    int getCycles() const { return cprCycles; }
+    CPRState getState() const { return state; }
     CPRThresholds getParams() const { return params; }
     void setRunning(bool run) { running = run; }
     bool isRunning() const { return running; }
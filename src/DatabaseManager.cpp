@@ -1,10 +1,42 @@
 #include "DatabaseManager.h"
 #include <time.h>
 
+namespace {
+
+// "YYYY-MM-DD HH:MM:SS.mmm", the stored "timestamp" form of an onset time
+String formatEventTime(uint32_t onsetTime) {
+    time_t timeSeconds = onsetTime / 1000;
+    int milliseconds = onsetTime % 1000;
+    struct tm* timeinfo = localtime(&timeSeconds);
+    char timeStr[32];
+    snprintf(timeStr, sizeof(timeStr), "%04d-%02d-%02d %02d:%02d:%02d.%03d",
+             timeinfo->tm_year + 1900, timeinfo->tm_mon + 1, timeinfo->tm_mday,
+             timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec, milliseconds);
+    return String(timeStr);
+}
+
+// Inverse of formatEventTime(), for files written before "onsetTime"
+uint32_t parseEventTime(const char* text) {
+    struct tm timeinfo = {};
+    int milliseconds = 0;
+    if (text == nullptr ||
+        sscanf(text, "%d-%d-%d %d:%d:%d.%d", &timeinfo.tm_year, &timeinfo.tm_mon, &timeinfo.tm_mday,
+               &timeinfo.tm_hour, &timeinfo.tm_min, &timeinfo.tm_sec, &milliseconds) != 7) {
+        return 0;
+    }
+    timeinfo.tm_year -= 1900;
+    timeinfo.tm_mon -= 1;
+    timeinfo.tm_isdst = -1;
+    return (uint32_t)mktime(&timeinfo) * 1000 + milliseconds;
+}
+
+} // namespace
+
 DatabaseManager::DatabaseManager() {
     currentSessionId = 0;
     dbInitialized = false;
     nextEventId = 1;
+    eventsHead = 0;
 }
 
 DatabaseManager::~DatabaseManager() {
@@ -37,9 +69,20 @@ void DatabaseManager::close() {
     }
 }
 
+void DatabaseManager::appendEvent(const CompressionEvent& event) {
+    if (events.size() < MAX_EVENTS) {
+        events.push_back(event);
+        return;
+    }
+    events[eventsHead] = event;
+    eventsHead = (eventsHead + 1) % MAX_EVENTS;
+}
+
 bool DatabaseManager::loadSessionsFromFile() {
     sessions.clear();
     events.clear();
+    events.reserve(MAX_EVENTS);   // One allocation, instead of growing past the cap
+    eventsHead = 0;
     
     // Load sessions
     if (SPIFFS.exists(sessionFile)) {
@@ -57,6 +100,14 @@ bool DatabaseManager::loadSessionsFromFile() {
                 session.endTime = obj["endTime"].as<String>();
                 session.rateAvg = obj["rateAvg"];
                 session.depthAvg = obj["depthAvg"];
+                session.rateP10 = obj["rateP10"];
+                session.rateP50 = obj["rateP50"];
+                session.rateP90 = obj["rateP90"];
+                session.depthP10 = obj["depthP10"];
+                session.depthP50 = obj["depthP50"];
+                session.depthP90 = obj["depthP90"];
+                session.recoilAvg = obj["recoilAvg"];
+                session.recoilP90 = obj["recoilP90"];
                 session.goodCompressions = obj["goodCompressions"];
                 session.totalCompressions = obj["totalCompressions"];
                 session.syncStatus = obj["syncStatus"];
@@ -78,11 +129,15 @@ bool DatabaseManager::loadSessionsFromFile() {
                 CompressionEvent event;
                 event.id = obj["id"];
                 event.sessionId = obj["sessionId"];
-                event.timestamp = obj["timestamp"].as<String>();
-                event.value = obj["value"];
-                event.state = obj["state"].as<String>();
+                event.onsetTime = obj["onsetTime"].is<uint32_t>() ? obj["onsetTime"].as<uint32_t>()
+                                                                  : parseEventTime(obj["timestamp"].as<const char*>());
+                event.depth = obj["depth"] | obj["value"].as<int>(); // Older files sampled "value"
+                event.recoil = obj["recoil"] | 0;
+                event.interval = obj["interval"] | 0;
+                event.duration = obj["duration"] | 0;
+                event.flags = obj["flags"] | 0;
                 event.isGood = obj["isGood"];
-                events.push_back(event);
+                appendEvent(event);
                 
                 nextEventId = max(nextEventId, event.id + 1);
             }
@@ -105,6 +160,14 @@ bool DatabaseManager::saveSessionsToFile() {
         obj["endTime"] = session.endTime;
         obj["rateAvg"] = session.rateAvg;
         obj["depthAvg"] = session.depthAvg;
+        obj["rateP10"] = session.rateP10;
+        obj["rateP50"] = session.rateP50;
+        obj["rateP90"] = session.rateP90;
+        obj["depthP10"] = session.depthP10;
+        obj["depthP50"] = session.depthP50;
+        obj["depthP90"] = session.depthP90;
+        obj["recoilAvg"] = session.recoilAvg;
+        obj["recoilP90"] = session.recoilP90;
         obj["goodCompressions"] = session.goodCompressions;
         obj["totalCompressions"] = session.totalCompressions;
         obj["syncStatus"] = session.syncStatus;
@@ -119,19 +182,23 @@ bool DatabaseManager::saveSessionsToFile() {
         return false;
     }
     
-    // Save events (limit to last 1000 events to prevent file getting too large)
+    // Save events (the last MAX_EVENTS, all that are kept)
     JsonDocument eventsDoc;
     JsonArray eventsArray = eventsDoc["events"].to<JsonArray>();
     
-    size_t startIndex = events.size() > 1000 ? events.size() - 1000 : 0;
-    for (size_t i = startIndex; i < events.size(); i++) {
+    for (size_t i = 0; i < events.size(); i++) {
+        const CompressionEvent& event = eventAt(i);
         JsonObject obj = eventsArray.add<JsonObject>();
-        obj["id"] = events[i].id;
-        obj["sessionId"] = events[i].sessionId;
-        obj["timestamp"] = events[i].timestamp;
-        obj["value"] = events[i].value;
-        obj["state"] = events[i].state;
-        obj["isGood"] = events[i].isGood;
+        obj["id"] = event.id;
+        obj["sessionId"] = event.sessionId;
+        obj["onsetTime"] = event.onsetTime;
+        obj["timestamp"] = formatEventTime(event.onsetTime);
+        obj["depth"] = event.depth;
+        obj["recoil"] = event.recoil;
+        obj["interval"] = event.interval;
+        obj["duration"] = event.duration;
+        obj["flags"] = event.flags;
+        obj["isGood"] = event.isGood;
     }
     
     file = SPIFFS.open(eventsFile, "w");
@@ -170,6 +237,9 @@ int DatabaseManager::startNewSession() {
     newSession.endTime = "";
     newSession.rateAvg = 0;
     newSession.depthAvg = 0;
+    newSession.rateP10 = newSession.rateP50 = newSession.rateP90 = 0;
+    newSession.depthP10 = newSession.depthP50 = newSession.depthP90 = 0;
+    newSession.recoilAvg = newSession.recoilP90 = 0;
     newSession.goodCompressions = 0;
     newSession.totalCompressions = 0;
     newSession.syncStatus = 0;
@@ -204,8 +274,37 @@ void DatabaseManager::endCurrentSession() {
     currentSessionId = 0;
 }
 
-bool DatabaseManager::recordCompressionEvent(unsigned long timestamp, float value, 
-                                           const String& state, bool isGood) {
+void DatabaseManager::endCurrentSession(const CPRSessionSummary& summary) {
+    if (currentSessionId <= 0 || !dbInitialized) {
+        return;
+    }
+    
+    for (auto& session : sessions) {
+        if (session.sessionId == currentSessionId) {
+            session.rateAvg = summary.rate.mean;
+            session.rateP10 = summary.rate.p10;
+            session.rateP50 = summary.rate.p50;
+            session.rateP90 = summary.rate.p90;
+            session.depthAvg = summary.depth.mean;
+            session.depthP10 = summary.depth.p10;
+            session.depthP50 = summary.depth.p50;
+            session.depthP90 = summary.depth.p90;
+            session.recoilAvg = summary.recoil.mean;
+            session.recoilP90 = summary.recoil.p90;
+            session.goodCompressions = summary.goodCompressions;
+            session.totalCompressions = summary.totalCompressions;
+            
+            Serial.printf("Session %d summary: rate %.0f (p50 %.0f), depth %.0f (p10 %.0f / p90 %.0f), %d/%d good\n",
+                          currentSessionId, summary.rate.mean, summary.rate.p50, summary.depth.mean,
+                          summary.depth.p10, summary.depth.p90, summary.goodCompressions, summary.totalCompressions);
+            break;
+        }
+    }
+    
+    endCurrentSession();
+}
+
+bool DatabaseManager::recordCompressionEvent(const CPRCompressionEvent& compression) {
     if (currentSessionId <= 0 || !dbInitialized) {
         return false;
     }
@@ -213,25 +312,18 @@ bool DatabaseManager::recordCompressionEvent(unsigned long timestamp, float valu
     CompressionEvent event;
     event.id = nextEventId++;
     event.sessionId = currentSessionId;
+    event.onsetTime = compression.onsetTime;
+    event.depth = compression.peakDepth;
+    event.recoil = compression.recoilMin;
+    event.interval = compression.interval;
+    event.duration = compression.duration;
+    event.flags = compression.flags;
+    event.isGood = compression.isGood();
     
-    // Convert timestamp to readable format
-    time_t timeSeconds = timestamp / 1000;
-    int milliseconds = timestamp % 1000;
-    struct tm* timeinfo = localtime(&timeSeconds);
-    char timeStr[32];
-    snprintf(timeStr, sizeof(timeStr), "%04d-%02d-%02d %02d:%02d:%02d.%03d",
-             timeinfo->tm_year + 1900, timeinfo->tm_mon + 1, timeinfo->tm_mday,
-             timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec, milliseconds);
-    
-    event.timestamp = String(timeStr);
-    event.value = value;
-    event.state = state;
-    event.isGood = isGood;
-    
-    events.push_back(event);
+    appendEvent(event);
     
     // Save periodically (every 100 events) to prevent data loss
-    if (events.size() % 100 == 0) {
+    if (event.id % 100 == 0) {
         saveSessionsToFile();
     }
     
@@ -265,9 +357,9 @@ std::vector<SessionData> DatabaseManager::getAllSessions(int limit) {
 std::vector<CompressionEvent> DatabaseManager::getSessionEvents(int sessionId) {
     std::vector<CompressionEvent> sessionEvents;
     
-    for (const auto& event : events) {
-        if (event.sessionId == sessionId) {
-            sessionEvents.push_back(event);
+    for (size_t i = 0; i < events.size(); i++) {
+        if (eventAt(i).sessionId == sessionId) {
+            sessionEvents.push_back(eventAt(i));
         }
     }
     
@@ -338,19 +430,32 @@ String DatabaseManager::createBackup() {
         obj["endTime"] = session.endTime;
         obj["rateAvg"] = session.rateAvg;
         obj["depthAvg"] = session.depthAvg;
+        obj["rateP10"] = session.rateP10;
+        obj["rateP50"] = session.rateP50;
+        obj["rateP90"] = session.rateP90;
+        obj["depthP10"] = session.depthP10;
+        obj["depthP50"] = session.depthP50;
+        obj["depthP90"] = session.depthP90;
+        obj["recoilAvg"] = session.recoilAvg;
+        obj["recoilP90"] = session.recoilP90;
         obj["goodCompressions"] = session.goodCompressions;
         obj["totalCompressions"] = session.totalCompressions;
         obj["syncStatus"] = session.syncStatus;
     }
     
     JsonArray eventsArray = doc["events"].to<JsonArray>();
-    for (const auto& event : events) {
+    for (size_t i = 0; i < events.size(); i++) {
+        const CompressionEvent& event = eventAt(i);
         JsonObject obj = eventsArray.add<JsonObject>();
         obj["id"] = event.id;
         obj["sessionId"] = event.sessionId;
-        obj["timestamp"] = event.timestamp;
-        obj["value"] = event.value;
-        obj["state"] = event.state;
+        obj["onsetTime"] = event.onsetTime;
+        obj["timestamp"] = formatEventTime(event.onsetTime);
+        obj["depth"] = event.depth;
+        obj["recoil"] = event.recoil;
+        obj["interval"] = event.interval;
+        obj["duration"] = event.duration;
+        obj["flags"] = event.flags;
         obj["isGood"] = event.isGood;
     }
     
@@ -6,6 +6,7 @@
 #include <ArduinoJson.h>
 #include <vector>
 #include <tuple>
+#include "CPRMetricsCalculator.h"
 
 struct SessionData {
     int sessionId;
@@ -13,17 +14,29 @@ struct SessionData {
     String endTime;
     float rateAvg;
     float depthAvg;
+    float rateP10;
+    float rateP50;
+    float rateP90;
+    float depthP10;
+    float depthP50;
+    float depthP90;
+    float recoilAvg;
+    float recoilP90;
     int goodCompressions;
     int totalCompressions;
     int syncStatus;
 };
 
+// Stored form of one CPRCompressionEvent
 struct CompressionEvent {
     int id;
     int sessionId;
-    String timestamp;
-    float value;
-    String state;
+    uint32_t onsetTime;     // ms; formatted only when written out
+    int depth;              // Peak, calculator units
+    int recoil;             // Recoil minimum, calculator units
+    int interval;           // ms since the previous onset
+    int duration;           // ms from onset to the end of recoil
+    int flags;              // CPRCompressionFlag bits
     bool isGood;
 };
 
@@ -37,8 +50,15 @@ private:
     bool saveSessionsToFile();
     bool loadSessionsFromFile();
     std::vector<SessionData> sessions;
-    std::vector<CompressionEvent> events;
     int nextEventId;
+    
+    // The most recent MAX_EVENTS events, in RAM and in eventsFile. A ring:
+    // once full, eventsHead is the oldest and the next one to be replaced.
+    static constexpr size_t MAX_EVENTS = 1000;
+    std::vector<CompressionEvent> events;
+    size_t eventsHead;
+    void appendEvent(const CompressionEvent& event);
+    const CompressionEvent& eventAt(size_t index) const { return events[(eventsHead + index) % events.size()]; }
 
 public:
     DatabaseManager();
@@ -50,10 +70,11 @@ public:
     // Session management
     int startNewSession();
     void endCurrentSession();
+    void endCurrentSession(const CPRSessionSummary& summary);  // Also stores the session distributions
     int getCurrentSessionId() const { return currentSessionId; }
     
     // Data recording
-    bool recordCompressionEvent(unsigned long timestamp, float value, const String& state, bool isGood);
+    bool recordCompressionEvent(const CPRCompressionEvent& compression);
     
     // Data retrieval
     std::vector<SessionData> getUnSyncedSessions();
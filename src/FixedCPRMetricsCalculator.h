@@ -0,0 +1,174 @@
+#ifndef FIXED_CPR_METRICS_CALCULATOR_H
+#define FIXED_CPR_METRICS_CALCULATOR_H
+
+#include <Arduino.h>
+#include "CPRMetricsCalculator.h"
+#include "RingBuffer.h"
+
+// Compile-time configuration for FixedCPRMetricsCalculator. Copy this struct,
+// change the values and pass it as the template argument for a fixed deployment.
+struct DefaultCPRConfig {
+    static constexpr int R1 = 200;   // Recoil low value
+    static constexpr int R2 = 300;   // Recoil high value
+    static constexpr int C1 = 700;   // Compression low value
+    static constexpr int C2 = 900;   // Compression high value
+    static constexpr int F1 = 100;   // Minimum CPR rate
+    static constexpr int F2 = 120;   // Maximum CPR rate
+    static constexpr float QUIETUDE_PERCENT = 0.2f;
+    static constexpr float HYSTERESIS_MARGIN = 0.01f;
+    static constexpr float RATE_SMOOTHING_FACTOR = 0.3f;
+    static constexpr size_t SMOOTHING_WINDOW = 3;
+    static constexpr size_t TREND_BUFFER_SIZE = 3;
+    static constexpr size_t AVERAGING_WINDOW = 100;
+    static constexpr size_t RATE_WINDOW = 9;
+};
+
+// Slope-detector calculator whose thresholds, derived thresholds and window
+// sizes are compile-time constants. The per-sample front end (smoothing,
+// slope, event classification) is specialised for Config; everything that
+// only runs on a state change (rate, quality counts, CCF, alerts, session
+// statistics) is the shared CPRMetricsCalculator code, so both variants
+// produce the same metrics for the same samples.
+//
+// Use CPRMetricsCalculator when thresholds must be changed at runtime
+// (/config), the zero-crossing detector or the high-rate front end is needed.
+template <typename Config>
+class FixedCPRMetricsCalculator {
+    static_assert(Config::SMOOTHING_WINDOW >= 1 &&
+                  Config::SMOOTHING_WINDOW <= CPRMetricsCalculator::MAX_SMOOTHING_WINDOW,
+                  "SMOOTHING_WINDOW out of range");
+    static_assert(Config::TREND_BUFFER_SIZE >= 1 &&
+                  Config::TREND_BUFFER_SIZE <= CPRMetricsCalculator::MAX_TREND_BUFFER_SIZE,
+                  "TREND_BUFFER_SIZE out of range");
+    static_assert(Config::AVERAGING_WINDOW >= 1 &&
+                  Config::AVERAGING_WINDOW <= CPRMetricsCalculator::MAX_AVERAGING_WINDOW,
+                  "AVERAGING_WINDOW out of range");
+    static_assert(Config::RATE_WINDOW >= 1 && Config::RATE_WINDOW <= CPRMetricsCalculator::MAX_RATE_WINDOW,
+                  "RATE_WINDOW out of range");
+    static_assert(Config::R1 < Config::C2, "Operating range must be positive");
+
+public:
+    // Same derivations as CPRMetricsCalculator::reset(), folded at compile time
+    static constexpr float QUIETUDE_THRESHOLD =
+        Config::R1 + (Config::QUIETUDE_PERCENT * (float)(Config::C2 - Config::R1));
+    static constexpr float MIN_COMPRESSION_AMPLITUDE = (float)(Config::C1 * 0.5);
+    static constexpr float SLOPE_MARGIN = Config::HYSTERESIS_MARGIN * 1000;
+
+private:
+    CPRMetricsCalculator metrics;
+    FixedWindow<float, Config::SMOOTHING_WINDOW> valueHistory;
+    FixedWindow<float, CPRMetricsCalculator::PEAK_WINDOW> peakHistory;
+    FixedWindow<float, Config::TREND_BUFFER_SIZE> trendBuffer;
+    float previousSmoothValue;
+
+    bool processSample(float rawValue, unsigned long now) {
+        valueHistory.push(rawValue);
+        float smoothedValue = (Config::SMOOTHING_WINDOW > 1) ? valueHistory.average() : rawValue;
+
+        peakHistory.push(rawValue);
+        float peakSmoothedValue = peakHistory.average();
+
+        float slope = (previousSmoothValue != 0) ? smoothedValue - previousSmoothValue : 0;
+        previousSmoothValue = smoothedValue;
+
+        trendBuffer.push(slope);
+        float avgSlope = trendBuffer.average();
+
+        CPRTrendEvent event = CPRTrendEvent::None;
+        if (avgSlope > SLOPE_MARGIN && smoothedValue > MIN_COMPRESSION_AMPLITUDE) {
+            event = CPRTrendEvent::Rising;
+        } else if (avgSlope < -SLOPE_MARGIN * 1.5) {
+            event = CPRTrendEvent::Falling;
+        } else if (smoothedValue <= QUIETUDE_THRESHOLD) {
+            event = CPRTrendEvent::Settled;
+        }
+
+        return metrics.applyTrendEvent(event, rawValue, smoothedValue, peakSmoothedValue, now, now);
+    }
+
+public:
+    FixedCPRMetricsCalculator() : previousSmoothValue(0) {
+        metrics.updateParams(params());
+    }
+
+    // The equivalent runtime parameters (what /get_config would report)
+    static CPRThresholds params() {
+        CPRThresholds p;
+        p.r1 = Config::R1;
+        p.r2 = Config::R2;
+        p.c1 = Config::C1;
+        p.c2 = Config::C2;
+        p.f1 = Config::F1;
+        p.f2 = Config::F2;
+        p.quietudePercent = Config::QUIETUDE_PERCENT;
+        p.hysteresisMargin = Config::HYSTERESIS_MARGIN;
+        p.rateSmoothingFactor = Config::RATE_SMOOTHING_FACTOR;
+        p.smoothingWindow = Config::SMOOTHING_WINDOW;
+        p.trendBufferSize = Config::TREND_BUFFER_SIZE;
+        p.averagingWindow = Config::AVERAGING_WINDOW;
+        p.rateWindow = Config::RATE_WINDOW;
+        p.detectorMode = CPRDetectorMode::Slope;
+        return p;
+    }
+
+    void reset() {
+        metrics.reset();
+        valueHistory.clear();
+        peakHistory.clear();
+        trendBuffer.clear();
+        previousSmoothValue = 0;
+    }
+
+    CPRSnapshot detectTrend(float rawValue) {
+        unsigned long now = millis();
+
+        if (!metrics.isRunning()) {
+            CPRSnapshot snapshot;
+            snapshot.state = metrics.getState();
+            snapshot.timestamp = now;
+            return snapshot;
+        }
+
+        processSample(rawValue, now);
+        return metrics.buildSnapshot(now);
+    }
+
+    // Same contract as CPRMetricsCalculator::detectTrendBatch()
+    size_t detectTrendBatch(const uint16_t* samples, const uint32_t* timestamps, size_t n,
+                            CPRSnapshot* lastSnapshot = nullptr,
+                            CPRTransition* transitions = nullptr, size_t maxTransitions = 0) {
+        size_t transitionCount = 0;
+
+        if (metrics.isRunning()) {
+            for (size_t i = 0; i < n; i++) {
+                CPRState previous = metrics.getState();
+                if (processSample(samples[i], timestamps[i]) && transitionCount < maxTransitions) {
+                    CPRTransition& t = transitions[transitionCount++];
+                    t.timestamp = timestamps[i];
+                    t.sampleIndex = i;
+                    t.from = previous;
+                    t.to = metrics.getState();
+                }
+            }
+        }
+
+        if (lastSnapshot != nullptr) {
+            unsigned long now = (n > 0) ? timestamps[n - 1] : millis();
+            *lastSnapshot = metrics.isRunning() ? metrics.buildSnapshot(now) : CPRSnapshot();
+            lastSnapshot->state = metrics.getState();
+            lastSnapshot->timestamp = now;
+        }
+
+        return transitionCount;
+    }
+
+    // Aggregates (getStatus, getCompressionMetrics, getSessionSummary, ...)
+    const CPRMetricsCalculator& getMetrics() const { return metrics; }
+    CPRStatus getStatus() const { return metrics.getStatus(); }
+    bool popCompressionEvent(CPRCompressionEvent& event) { return metrics.popCompressionEvent(event); }
+    CPRState getState() const { return metrics.getState(); }
+    void setRunning(bool run) { metrics.setRunning(run); }
+    bool isRunning() const { return metrics.isRunning(); }
+};
+
+#endif
@@ -0,0 +1,249 @@
+#include "MultiChannelCPRCalculator.h"
+#include "CPRCycleLogic.h"
+#include <cmath>
+
+namespace {
+
+// Push into column 'ch' of a [slot][channel] window; head is the next write slot.
+// The sum is rebuilt on each wrap so float rounding cannot accumulate.
+template <size_t Slots, size_t Channels>
+void pushWindow(float (&window)[Slots][Channels], size_t ch, float value, uint8_t capacity,
+                uint8_t& head, uint8_t& count, float& sum) {
+    if (count < capacity) {
+        count++;
+    } else {
+        sum -= window[head][ch];
+    }
+    window[head][ch] = value;
+    sum += value;
+
+    if (++head == capacity) {
+        head = 0;
+        float resynced = 0;
+        for (size_t i = 0; i < count; i++) {
+            resynced += window[i][ch];
+        }
+        sum = resynced;
+    }
+}
+
+} // namespace
+
+struct MultiChannelCPRCalculator::ChannelAccess {
+    MultiChannelCPRCalculator& m;
+    size_t ch;
+
+    const CPRThresholds& params() const { return m.params[ch]; }
+    CPRState& state() const { return m.state[ch]; }
+    unsigned long& lastStateChange() const { return m.lastStateChange[ch]; }
+    unsigned long& lastAlertTime() const { return m.lastAlertTime[ch]; }
+    unsigned long& activeTime() const { return m.activeTime[ch]; }
+    unsigned long& cycleStartTime() const { return m.cycleStartTime[ch]; }
+    unsigned long& lastQuietudeEnterTime() const { return m.lastQuietudeEnterTime[ch]; }
+    float& ccf() const { return m.ccf[ch]; }
+    int& cprCycles() const { return m.cprCycles[ch]; }
+    bool& validCycleStarted() const { return m.validCycleStarted[ch]; }
+    bool& seenCompression() const { return m.seenCompression[ch]; }
+    bool& seenRecoil() const { return m.seenRecoil[ch]; }
+    float& currentCompressionPeak() const { return m.currentCompressionPeak[ch]; }
+    float& currentRecoilMin() const { return m.currentRecoilMin[ch]; }
+    bool& lastCompressionWasOk() const { return m.lastCompressionWasOk[ch]; }
+    unsigned long& lastCompressionOnset() const { return m.lastCompressionOnset[ch]; }
+    SlidingMedian<unsigned long, MAX_RATE_WINDOW>& compressionIntervals() const { return m.compressionIntervals[ch]; }
+    RingBuffer<float, MAX_AVERAGING_WINDOW>& depthPeaks() const { return m.depthPeaks[ch]; }
+    RingBuffer<float, MAX_AVERAGING_WINDOW>& recoilMins() const { return m.recoilMins[ch]; }
+    int& goodCompressions() const { return m.goodCompressions[ch]; }
+    int& totalCompressions() const { return m.totalCompressions[ch]; }
+    int& goodRecoils() const { return m.goodRecoils[ch]; }
+    int& incompleteRecoils() const { return m.incompleteRecoils[ch]; }
+    int& totalRecoils() const { return m.totalRecoils[ch]; }
+    float& smoothedRate() const { return m.smoothedRate[ch]; }
+    int& currentRate() const { return m.currentRate[ch]; }
+    int& displayedRate() const { return m.displayedRate[ch]; }
+    unsigned long& lastValidRateTime() const { return m.lastValidRateTime[ch]; }
+    CPRAlerts& alerts() const { return m.alerts[ch]; }
+
+    // Onset intervals are the only rate source, and no events or session
+    // statistics are kept per channel
+    bool hasEstimatedRate() const { return false; }
+    void leaveState(CPRState, unsigned long) const {}
+    void compressionOnset(unsigned long, unsigned long, bool) const {}
+    void compressionEnded(float, bool) const {}
+    void recoilEnded(float, bool) const {}
+    void noRecoil() const {}
+};
+
+MultiChannelCPRCalculator::MultiChannelCPRCalculator() : channelCount(0) {
+    configure(1);
+}
+
+CPRThresholds MultiChannelCPRCalculator::clampParams(const CPRThresholds& requested) {
+    CPRThresholds clamped = CPRMetricsCalculator::clampParams(requested);
+    clamped.averagingWindow = min(clamped.averagingWindow, (int)MAX_AVERAGING_WINDOW);
+    return clamped;
+}
+
+void MultiChannelCPRCalculator::configure(size_t channels, const CPRThresholds& defaults) {
+    channelCount = (channels > MAX_CHANNELS) ? MAX_CHANNELS : channels;
+    CPRThresholds clamped = clampParams(defaults);
+    for (size_t ch = 0; ch < MAX_CHANNELS; ch++) {
+        params[ch] = clamped;
+    }
+    reset();
+}
+
+void MultiChannelCPRCalculator::setChannelParams(size_t ch, const CPRThresholds& channelParams) {
+    if (ch >= channelCount) {
+        return;
+    }
+    params[ch] = clampParams(channelParams);
+    resetChannel(ch);
+}
+
+void MultiChannelCPRCalculator::reset() {
+    for (size_t ch = 0; ch < channelCount; ch++) {
+        resetChannel(ch);
+    }
+
+    Serial.printf("Multi-channel CPR calculator: %u channels reset\n", (unsigned)channelCount);
+}
+
+void MultiChannelCPRCalculator::updateDerived(size_t ch) {
+    const CPRThresholds& p = params[ch];
+    float operatingRange = p.c2 - p.r1;
+    quietudeThreshold[ch] = p.r1 + (p.quietudePercent * operatingRange);
+    minCompressionAmplitude[ch] = p.c1 * 0.5;
+    slopeMargin[ch] = p.hysteresisMargin * 1000; // Scale for ADC values
+    valueCapacity[ch] = (uint8_t)p.smoothingWindow;
+    slopeCapacity[ch] = (uint8_t)p.trendBufferSize;
+}
+
+void MultiChannelCPRCalculator::resetChannel(size_t ch) {
+    if (ch >= MAX_CHANNELS) {
+        return;
+    }
+    updateDerived(ch);
+
+    valueSum[ch] = peakSum[ch] = slopeSum[ch] = 0;
+    valueHead[ch] = peakHead[ch] = slopeHead[ch] = 0;
+    valueCount[ch] = peakCount[ch] = slopeCount[ch] = 0;
+    smoothedValue[ch] = 0;
+    previousSmoothValue[ch] = 0;
+
+    state[ch] = CPRState::Quietude;
+    lastStateChange[ch] = millis();
+    currentCompressionPeak[ch] = 0;
+    currentRecoilMin[ch] = 1023; // Max value for minimum tracking
+
+    lastCompressionWasOk[ch] = false;
+    lastCompressionOnset[ch] = 0;
+    compressionIntervals[ch].setWindow(params[ch].rateWindow);
+    depthPeaks[ch].setCapacity(params[ch].averagingWindow);
+    recoilMins[ch].setCapacity(params[ch].averagingWindow);
+    smoothedRate[ch] = 0;
+    currentRate[ch] = 0;
+    displayedRate[ch] = 0;
+    lastValidRateTime[ch] = 0;
+    goodCompressions[ch] = 0;
+    totalCompressions[ch] = 0;
+    goodRecoils[ch] = 0;
+    incompleteRecoils[ch] = 0;
+    totalRecoils[ch] = 0;
+    alerts[ch].clear();
+    lastAlertTime[ch] = 0;
+
+    cycleStartTime[ch] = 0;
+    activeTime[ch] = 0;
+    lastQuietudeEnterTime[ch] = 0;
+    validCycleStarted[ch] = false;
+    seenCompression[ch] = false;
+    seenRecoil[ch] = false;
+    ccf[ch] = 0;
+    cprCycles[ch] = 0;
+}
+
+void MultiChannelCPRCalculator::process(const uint16_t* samples, unsigned long now, CPRSnapshot* snapshots) {
+    for (size_t ch = 0; ch < channelCount; ch++) {
+        float rawValue = samples[ch];
+
+        // State detection smoothing and light (3-sample) peak smoothing
+        pushWindow(valueWindow, ch, rawValue, valueCapacity[ch], valueHead[ch], valueCount[ch], valueSum[ch]);
+        float smoothed = (valueCapacity[ch] > 1) ? valueSum[ch] / valueCount[ch] : rawValue;
+        smoothedValue[ch] = smoothed;
+
+        pushWindow(peakWindow, ch, rawValue, (uint8_t)PEAK_WINDOW, peakHead[ch], peakCount[ch], peakSum[ch]);
+        float peakSmoothed = peakSum[ch] / peakCount[ch];
+
+        float slope = (previousSmoothValue[ch] != 0) ? smoothed - previousSmoothValue[ch] : 0;
+        previousSmoothValue[ch] = smoothed;
+
+        pushWindow(slopeWindow, ch, slope, slopeCapacity[ch], slopeHead[ch], slopeCount[ch], slopeSum[ch]);
+        float avgSlope = slopeSum[ch] / slopeCount[ch];
+
+        float margin = slopeMargin[ch];
+        CPRTrendEvent event = CPRTrendEvent::None;
+        if (avgSlope > margin && smoothed > minCompressionAmplitude[ch]) {
+            event = CPRTrendEvent::Rising;
+        } else if (avgSlope < -margin * 1.5) {
+            event = CPRTrendEvent::Falling;
+        } else if (smoothed <= quietudeThreshold[ch]) {
+            event = CPRTrendEvent::Settled;
+        }
+
+        CPRCycleLogic<ChannelAccess>::applyEvent(ChannelAccess{*this, ch}, event, peakSmoothed, now, now);
+
+        if (snapshots != nullptr) {
+            snapshots[ch] = getSnapshot(ch, now);
+        }
+    }
+}
+
+CPRSnapshot MultiChannelCPRCalculator::getSnapshot(size_t ch, unsigned long now) const {
+    CPRSnapshot snapshot;
+    snapshot.timestamp = now;
+    if (ch >= channelCount) {
+        return snapshot;
+    }
+
+    const CPRThresholds& p = params[ch];
+    snapshot.state = state[ch];
+    snapshot.currentRate = displayedRate[ch];
+    snapshot.rawValue = smoothedValue[ch];
+    snapshot.ccf = ccf[ch];
+    snapshot.currentCompression.peakValue = currentCompressionPeak[ch];
+    snapshot.currentCompression.isGood = (state[ch] == CPRState::Compression) &&
+        (p.c1 <= currentCompressionPeak[ch] && currentCompressionPeak[ch] <= p.c2);
+    snapshot.currentRecoil.minValue = (currentRecoilMin[ch] != 1023) ? currentRecoilMin[ch] : 0;
+    snapshot.currentRecoil.isGood = (state[ch] == CPRState::Recoil && currentRecoilMin[ch] != 1023) &&
+        (currentRecoilMin[ch] <= p.r2);
+    snapshot.alerts = alerts[ch];
+    return snapshot;
+}
+
+CompressionMetrics MultiChannelCPRCalculator::getCompressionMetrics(size_t ch) const {
+    CompressionMetrics metrics;
+    if (ch >= channelCount) {
+        return metrics;
+    }
+
+    metrics.good = goodCompressions[ch];
+    metrics.total = totalCompressions[ch];
+    metrics.ratio = (totalCompressions[ch] > 0) ? (float)goodCompressions[ch] / totalCompressions[ch] : 0;
+    metrics.isGood = (state[ch] == CPRState::Compression) &&
+        (params[ch].c1 <= currentCompressionPeak[ch] && currentCompressionPeak[ch] <= params[ch].c2);
+    metrics.average = depthPeaks[ch].average();
+    return metrics;
+}
+
+RecoilMetrics MultiChannelCPRCalculator::getRecoilMetrics(size_t ch) const {
+    RecoilMetrics metrics;
+    if (ch >= channelCount) {
+        return metrics;
+    }
+
+    metrics.goodRecoil = goodRecoils[ch];
+    metrics.incompleteRecoil = incompleteRecoils[ch];
+    metrics.total = totalRecoils[ch];
+    metrics.ratio = (totalRecoils[ch] > 0) ? (float)goodRecoils[ch] / totalRecoils[ch] : 0;
+    return metrics;
+}
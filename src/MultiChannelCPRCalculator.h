@@ -0,0 +1,122 @@
+#ifndef MULTI_CHANNEL_CPR_CALCULATOR_H
+#define MULTI_CHANNEL_CPR_CALCULATOR_H
+
+#include <Arduino.h>
+#include "CPRMetricsCalculator.h"
+
+// Runs the slope-based CPR state machine for several sensor channels (several
+// manikins, or several force points on one) in a single pass per sample tick.
+//
+// The per-sample front end (smoothing, slope, event classification) keeps its
+// windows as struct-of-arrays, [slot][channel] with per-channel heads, so one
+// tick walks contiguous memory. Everything after classification is
+// CPRCycleLogic, the same code CPRMetricsCalculator runs, over per-channel
+// fixed-capacity windows: a channel reports the rate, depth, recoil, CCF and
+// alerts a CPRMetricsCalculator with the same thresholds would.
+//
+// Not carried per channel: the zero-crossing detector, the autocorrelation
+// rate source, the high-rate front end, compression events and session
+// statistics. averagingWindow is limited to MAX_AVERAGING_WINDOW.
+class MultiChannelCPRCalculator {
+public:
+    static constexpr size_t MAX_CHANNELS = 8;
+    static constexpr size_t MAX_SMOOTHING_WINDOW = CPRMetricsCalculator::MAX_SMOOTHING_WINDOW;
+    static constexpr size_t MAX_TREND_BUFFER_SIZE = CPRMetricsCalculator::MAX_TREND_BUFFER_SIZE;
+    static constexpr size_t PEAK_WINDOW = CPRMetricsCalculator::PEAK_WINDOW;
+    static constexpr size_t MAX_AVERAGING_WINDOW = 128;
+    static constexpr size_t MAX_RATE_WINDOW = CPRMetricsCalculator::MAX_RATE_WINDOW;
+
+private:
+    size_t channelCount;
+    CPRThresholds params[MAX_CHANNELS];
+
+    // Derived thresholds, computed once per resetChannel()
+    float quietudeThreshold[MAX_CHANNELS];
+    float minCompressionAmplitude[MAX_CHANNELS];
+    float slopeMargin[MAX_CHANNELS];
+
+    // Smoothing, peak and trend windows: [slot][channel] with per-channel heads
+    float valueWindow[MAX_SMOOTHING_WINDOW][MAX_CHANNELS];
+    float peakWindow[PEAK_WINDOW][MAX_CHANNELS];
+    float slopeWindow[MAX_TREND_BUFFER_SIZE][MAX_CHANNELS];
+    float valueSum[MAX_CHANNELS];
+    float peakSum[MAX_CHANNELS];
+    float slopeSum[MAX_CHANNELS];
+    float smoothedValue[MAX_CHANNELS];
+    uint8_t valueCapacity[MAX_CHANNELS];
+    uint8_t slopeCapacity[MAX_CHANNELS];
+    uint8_t valueHead[MAX_CHANNELS];
+    uint8_t peakHead[MAX_CHANNELS];
+    uint8_t slopeHead[MAX_CHANNELS];
+    uint8_t valueCount[MAX_CHANNELS];
+    uint8_t peakCount[MAX_CHANNELS];
+    uint8_t slopeCount[MAX_CHANNELS];
+
+    // Hot per-sample state
+    CPRState state[MAX_CHANNELS];
+    float previousSmoothValue[MAX_CHANNELS];
+    float currentCompressionPeak[MAX_CHANNELS];
+    float currentRecoilMin[MAX_CHANNELS];
+    unsigned long lastStateChange[MAX_CHANNELS];
+
+    // Per-compression state
+    bool lastCompressionWasOk[MAX_CHANNELS];
+    unsigned long lastCompressionOnset[MAX_CHANNELS];
+    SlidingMedian<unsigned long, MAX_RATE_WINDOW> compressionIntervals[MAX_CHANNELS];
+    RingBuffer<float, MAX_AVERAGING_WINDOW> depthPeaks[MAX_CHANNELS];
+    RingBuffer<float, MAX_AVERAGING_WINDOW> recoilMins[MAX_CHANNELS];
+    float smoothedRate[MAX_CHANNELS];
+    int currentRate[MAX_CHANNELS];
+    int displayedRate[MAX_CHANNELS];
+    unsigned long lastValidRateTime[MAX_CHANNELS];
+    int goodCompressions[MAX_CHANNELS];
+    int totalCompressions[MAX_CHANNELS];
+    int goodRecoils[MAX_CHANNELS];
+    int incompleteRecoils[MAX_CHANNELS];
+    int totalRecoils[MAX_CHANNELS];
+    CPRAlerts alerts[MAX_CHANNELS];
+    unsigned long lastAlertTime[MAX_CHANNELS];
+
+    // CCF tracking
+    unsigned long cycleStartTime[MAX_CHANNELS];
+    unsigned long activeTime[MAX_CHANNELS];
+    unsigned long lastQuietudeEnterTime[MAX_CHANNELS];
+    bool validCycleStarted[MAX_CHANNELS];
+    bool seenCompression[MAX_CHANNELS];
+    bool seenRecoil[MAX_CHANNELS];
+    float ccf[MAX_CHANNELS];
+    int cprCycles[MAX_CHANNELS];
+
+    // Resolves CPRCycleLogic's fields to column ch of the arrays above
+    struct ChannelAccess;
+
+    void updateDerived(size_t ch);
+
+public:
+    MultiChannelCPRCalculator();
+
+    // The windows limited to this engine's storage (on top of
+    // CPRMetricsCalculator::clampParams)
+    static CPRThresholds clampParams(const CPRThresholds& requested);
+
+    // Sets the number of channels (clamped to MAX_CHANNELS) and gives every
+    // channel the same thresholds; use setChannelParams() to differ per channel.
+    // Both store clampParams() of what they are given.
+    void configure(size_t channels, const CPRThresholds& defaults = CPRThresholds());
+    void setChannelParams(size_t ch, const CPRThresholds& channelParams);
+    void reset();
+    void resetChannel(size_t ch);
+
+    // One tick: samples[ch] (calculator units, 0-1023) for every configured
+    // channel, all taken at 'now'. Fills snapshots[ch] when non-null.
+    void process(const uint16_t* samples, unsigned long now, CPRSnapshot* snapshots = nullptr);
+
+    size_t getChannelCount() const { return channelCount; }
+    CPRThresholds getChannelParams(size_t ch) const { return params[ch]; }
+    CPRSnapshot getSnapshot(size_t ch, unsigned long now) const;
+    CompressionMetrics getCompressionMetrics(size_t ch) const;
+    RecoilMetrics getRecoilMetrics(size_t ch) const;
+    float getAverageRecoil(size_t ch) const { return (ch < channelCount) ? recoilMins[ch].average() : 0; }
+};
+
+#endif
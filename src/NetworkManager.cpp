@@ -1,51 +1,112 @@
 #include "NetworkManager.h"
 #include <HTTPClient.h>  
 
+// Called from loop(); returns immediately
 void NetworkManager::checkInternetConnectivity() {
-    // ADD THIS CHECK RIGHT HERE AT THE VERY BEGINNING
-    extern bool fileUploadInProgress; // Reference the global variable
-    if (fileUploadInProgress) {
-        Serial.println("⏸️ Skipping internet connectivity check - file upload in progress");
-        return;
-    }
-    
-    // EXISTING CODE CONTINUES BELOW
     unsigned long now = millis();
     
-    // Don't check too frequently
-    if (now - lastInternetCheck < INTERNET_CHECK_INTERVAL) {
+    // Don't check too frequently (the interval adapts to recent results)
+    if (now - lastInternetCheck < probeInterval) {
         return;
     }
     
+    extern bool fileUploadInProgress; // Reference the global variable
+    if (fileUploadInProgress) {
+        return; // Retried on the next call
+    }
+    
     lastInternetCheck = now;
     
     // Only check if we have WiFi connection
-    if (WiFi.status() != WL_CONNECTED) {
+    if (!isSTAConnected) {
         internetConnected = false;
-        isSTAConnected = false;
         return;
     }
     
-    // Update our tracking
-    isSTAConnected = true;
+    requestInternetProbe();
+}
+
+void NetworkManager::requestInternetProbe() {
+    if (probeTask != nullptr && !probeInFlight) {
+        xTaskNotifyGive(probeTask);
+    }
+}
+
+unsigned long NetworkManager::getNextProbeIn() const {
+    unsigned long elapsed = millis() - lastInternetCheck;
+    return elapsed >= probeInterval ? 0 : probeInterval - elapsed;
+}
+
+bool NetworkManager::beginInternetProbe() {
+    if (probeTask != nullptr) {
+        return true;
+    }
+    if (xTaskCreatePinnedToCore(probeTaskEntry, "net_probe", 4096, this, 1, &probeTask, 0) != pdPASS) {
+        Serial.println("❌ Failed to start the connectivity probe task");
+        probeTask = nullptr;
+        return false;
+    }
+    Serial.printf("🌐 Connectivity probe: %s\n", probeUrl.c_str());
+    return true;
+}
+
+void NetworkManager::probeTaskEntry(void* arg) {
+    NetworkManager* manager = static_cast<NetworkManager*>(arg);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        manager->runProbe();
+    }
+}
+
+// Probe task only: the blocking HTTP request lives here
+void NetworkManager::runProbe() {
+    probeInFlight = true;
+    unsigned long start = millis();
     
-    Serial.println("🌐 Checking internet connectivity...");
+    int httpCode;
+    if (WiFi.status() != WL_CONNECTED) {
+        httpCode = HTTPC_ERROR_NOT_CONNECTED;
+    } else {
+        HTTPClient http;
+        http.setConnectTimeout(PROBE_TIMEOUT_MS);
+        http.setTimeout(PROBE_TIMEOUT_MS);
+        if (http.begin(probeUrl)) {
+            httpCode = http.GET();
+            http.end();
+        } else {
+            httpCode = HTTPC_ERROR_CONNECTION_REFUSED;
+        }
+    }
     
-    HTTPClient http;
-    http.setTimeout(5000); // 5 second timeout
-    http.begin("http://connectivitycheck.gstatic.com/generate_204");
+    unsigned long end = millis();
+    bool connected = (httpCode == 204);
+    bool changed = (connected != internetConnected);
     
-    int httpCode = http.GET();
+    lastProbeCode = httpCode;
+    lastProbeLatency = end - start;
+    lastProbeTime = end;
+    internetConnected = connected;
     
-    if (httpCode == 204) {
-        internetConnected = true;
-        Serial.println("✅ Internet connectivity confirmed");
+    // Healthy: the normal interval. Failing: retry soon, then back off
+    // exponentially so a dead uplink is not hammered
+    if (connected) {
+        probeFailures = 0;
+        probeInterval = INTERNET_CHECK_INTERVAL;
     } else {
-        internetConnected = false;
-        Serial.printf("❌ Internet not available. HTTP code: %d\n", httpCode);
+        uint32_t failures = ++probeFailures;
+        unsigned long retry = PROBE_RETRY_MIN << (failures > 7 ? 6 : failures - 1);
+        probeInterval = retry > PROBE_RETRY_MAX ? PROBE_RETRY_MAX : retry;
+    }
+    probeInFlight = false;
+    
+    if (changed || !connected) {
+        if (connected) {
+            Serial.printf("✅ Internet connectivity confirmed (%lu ms)\n", end - start);
+        } else {
+            Serial.printf("❌ Internet not available. HTTP code: %d (retry in %lu s)\n",
+                          httpCode, (unsigned long)probeInterval / 1000);
+        }
     }
-    
-    http.end();
 }
 
 NetworkManager::NetworkManager() {
@@ -58,15 +119,50 @@ NetworkManager::NetworkManager() {
     connectionTimeout = 30000; // 30 seconds
     reconnectAttempts = 0;
     
+    // Connection state machine
+    wifiState = static_cast<uint8_t>(isSTAConnected ? WiFiState::Connected : WiFiState::Idle);
+    eventGotIP = false;
+    eventDisconnected = false;
+    lastDisconnectReason = 0;
+    retryAt = 0;
+    saveOnConnect = false;
+    credentialsConfirmed = false;
+    stateSince = millis();
+    stateCallback = nullptr;
+    requestMutex = xSemaphoreCreateMutex();
+    pendingRequest = WiFiRequest::None;
+    requestPosted = false;
+    
+    scanInProgress = false;
+    scanFailed = false;
+    eventScanDone = false;
+    scanStartedAt = 0;
+    scanCallback = nullptr;
+    
+    // Retries are ours; the core's own reconnect would race the state machine
+    WiFi.setAutoReconnect(false);
+    wifiEventHandle = WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info) {
+        onWiFiEvent(event, info);
+    });
+    
     // Initialize internet connectivity tracking
-    internetConnected = false;
+    probeUrl = INTERNET_PROBE_URL;
+    probeTask = nullptr;
     lastInternetCheck = 0;
+    internetConnected = false;
+    probeInFlight = false;
+    lastProbeTime = 0;
+    lastProbeLatency = 0;
+    lastProbeCode = 0;
+    probeFailures = 0;
+    probeInterval = INTERNET_CHECK_INTERVAL;
     
     preferences.begin("wifi", false);
     loadWiFiConfig();
 }
 
 NetworkManager::~NetworkManager() {
+    WiFi.removeEvent(wifiEventHandle);
     preferences.end();
 }
 
@@ -125,7 +221,9 @@ bool NetworkManager::connectToWiFi() {
         return false;
     }
     
-    return connectToWiFi(wifiConfig.ssid, wifiConfig.password);
+    // An empty SSID means the saved network, resolved in loop context
+    postRequest(WiFiRequest::Connect, String(), String());
+    return true;
 }
 
 bool NetworkManager::connectToWiFi(const String& ssid, const String& password) {
@@ -134,74 +232,199 @@ bool NetworkManager::connectToWiFi(const String& ssid, const String& password) {
         return false;
     }
     
-    Serial.printf("Connecting to WiFi: %s\n", ssid.c_str());
-    
-    // Disconnect if already connected
-    if (WiFi.status() == WL_CONNECTED) {
-        WiFi.disconnect();
-        delay(1000);
+    postRequest(WiFiRequest::Connect, ssid, password);
+    return true;
+}
+
+void NetworkManager::disconnectWiFi() {
+    postRequest(WiFiRequest::Disconnect, String(), String());
+}
+
+bool NetworkManager::saveWiFiCredentials(const String& ssid, const String& password) {
+    if (ssid.isEmpty()) {
+        Serial.println("Cannot save empty SSID");
+        return false;
     }
     
-    WiFi.begin(ssid.c_str(), password.c_str());
-    
-    unsigned long startTime = millis();
-    while (WiFi.status() != WL_CONNECTED && millis() - startTime < connectionTimeout) {
-        delay(500);
-        Serial.print(".");
+    // Test connection first; handleTasks() saves them once it succeeds
+    postRequest(WiFiRequest::Save, ssid, password);
+    Serial.printf("Testing WiFi credentials for: %s\n", ssid.c_str());
+    return true;
+}
+
+bool NetworkManager::takeConfirmedCredentials(WiFiConfig& out) {
+    if (!credentialsConfirmed) {
+        return false;
+    }
+    credentialsConfirmed = false;
+    out = wifiConfig;
+    return true;
+}
+
+// Any task: the latest request replaces one not yet applied
+void NetworkManager::postRequest(WiFiRequest request, const String& ssid, const String& password) {
+    xSemaphoreTake(requestMutex, portMAX_DELAY);
+    pendingRequest = request;
+    pendingSSID = ssid;
+    pendingPassword = password;
+    xSemaphoreGive(requestMutex);
+    requestPosted = true;
+}
+
+// Loop context, from handleTasks()
+void NetworkManager::applyPendingRequest() {
+    if (!requestPosted.exchange(false)) {
+        return;
     }
     
-    if (WiFi.status() == WL_CONNECTED) {
-        isSTAConnected = true;
-        lastConnectionAttempt = millis();
-        reconnectAttempts = 0;
-        
-        Serial.println();
-        Serial.printf("WiFi connected successfully!\n");
-        Serial.printf("IP address: %s\n", WiFi.localIP().toString().c_str());
-        Serial.printf("Signal strength: %d dBm\n", WiFi.RSSI());
+    xSemaphoreTake(requestMutex, portMAX_DELAY);
+    WiFiRequest request = pendingRequest;
+    String ssid = pendingSSID;
+    String password = pendingPassword;
+    pendingRequest = WiFiRequest::None;
+    pendingPassword = "";
+    xSemaphoreGive(requestMutex);
+    
+    switch (request) {
+        case WiFiRequest::Disconnect: {
+            // No retries after a deliberate disconnect
+            bool active = isSTAConnected || getWiFiState() != WiFiState::Idle;
+            saveOnConnect = false;
+            setWiFiState(WiFiState::Idle);
+            if (active) {
+                WiFi.disconnect();
+                isSTAConnected = false;
+                internetConnected = false;
+                Serial.println("WiFi disconnected");
+            }
+            break;
+        }
         
-        return true;
-    } else {
-        isSTAConnected = false;
-        reconnectAttempts++;
+        case WiFiRequest::Connect:
+            if (ssid.isEmpty()) {
+                if (!wifiConfig.isConfigured) {
+                    Serial.println("No WiFi credentials configured");
+                    break;
+                }
+                ssid = wifiConfig.ssid;
+                password = wifiConfig.password;
+            }
+            targetSSID = ssid;
+            targetPassword = password;
+            saveOnConnect = false;
+            reconnectAttempts = 0;
+            beginAttempt();
+            break;
         
-        Serial.println();
-        Serial.printf("WiFi connection failed (attempt %d)\n", reconnectAttempts);
+        case WiFiRequest::Save:
+            // Remember what to go back to, unless already testing other ones
+            if (!saveOnConnect) {
+                fallbackSSID = targetSSID;
+                fallbackPassword = targetPassword;
+            }
+            targetSSID = ssid;
+            targetPassword = password;
+            saveOnConnect = true;
+            reconnectAttempts = 0;
+            beginAttempt();
+            break;
         
-        return false;
+        default:
+            break;
     }
 }
 
-void NetworkManager::disconnectWiFi() {
-    if (isSTAConnected) {
-        WiFi.disconnect();
-        isSTAConnected = false;
-        Serial.println("WiFi disconnected");
+// WiFi event task: record what happened, handleTasks() acts on it
+void NetworkManager::onWiFiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+    switch (event) {
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            eventGotIP = true;
+            break;
+        case ARDUINO_EVENT_WIFI_SCAN_DONE:
+            eventScanDone = true;
+            break;
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+            // ASSOC_LEAVE is our own WiFi.disconnect()
+            if (info.wifi_sta_disconnected.reason != WIFI_REASON_ASSOC_LEAVE) {
+                lastDisconnectReason = info.wifi_sta_disconnected.reason;
+                eventDisconnected = true;
+            }
+            break;
+        default:
+            break;
     }
 }
 
-bool NetworkManager::saveWiFiCredentials(const String& ssid, const String& password) {
-    if (ssid.isEmpty()) {
-        Serial.println("Cannot save empty SSID");
-        return false;
+void NetworkManager::beginAttempt() {
+    reconnectAttempts++;
+    lastConnectionAttempt = millis();
+    Serial.printf("Connecting to WiFi: %s (attempt %d)\n", targetSSID.c_str(), reconnectAttempts.load());
+    
+    // Drop the current link first; its disconnect event is ignored
+    if (WiFi.status() == WL_CONNECTED) {
+        WiFi.disconnect();
     }
+    isSTAConnected = false;
+    eventGotIP = false;
     
-    // Test connection first
-    bool testResult = connectToWiFi(ssid, password);
+    WiFi.begin(targetSSID.c_str(), targetPassword.c_str());
+    setWiFiState(WiFiState::Connecting);
+}
+
+// Loop context: back off before the next attempt
+void NetworkManager::attemptFailed(const char* why) {
+    Serial.printf("WiFi connection failed (attempt %d): %s\n", reconnectAttempts.load(), why);
+    
+    if (saveOnConnect) {
+        // Untested credentials are not retried; go back to the previous network
+        Serial.printf("Failed to connect with provided credentials: %s\n", targetSSID.c_str());
+        saveOnConnect = false;
+        targetSSID = fallbackSSID;
+        targetPassword = fallbackPassword;
+        fallbackPassword = "";
+        reconnectAttempts = 0;
+        if (targetSSID.isEmpty()) {
+            WiFi.disconnect();
+            setWiFiState(WiFiState::Idle);
+            return;
+        }
+    }
     
-    if (testResult) {
-        // Save credentials
-        wifiConfig.ssid = ssid;
-        wifiConfig.password = password;
-        wifiConfig.isConfigured = true;
-        saveWiFiConfig();
-        
-        Serial.printf("WiFi credentials saved and tested successfully: %s\n", ssid.c_str());
-        return true;
-    } else {
-        Serial.printf("Failed to connect with provided credentials: %s\n", ssid.c_str());
-        return false;
+    int attempts = reconnectAttempts;
+    unsigned long backoff = RETRY_MIN << (attempts > 7 ? 6 : (attempts > 0 ? attempts - 1 : 0));
+    if (backoff > RETRY_MAX) {
+        backoff = RETRY_MAX;
     }
+    retryAt = millis() + backoff;
+    setWiFiState(WiFiState::WaitingRetry);
+}
+
+void NetworkManager::setWiFiState(WiFiState state) {
+    if (getWiFiState() == state) {
+        return;
+    }
+    wifiState = static_cast<uint8_t>(state);
+    stateSince = millis();
+    if (stateCallback != nullptr) {
+        stateCallback(state, targetSSID);
+    }
+}
+
+const char* NetworkManager::getWiFiStateName(WiFiState state) {
+    switch (state) {
+        case WiFiState::Connecting: return "connecting";
+        case WiFiState::Connected: return "connected";
+        case WiFiState::WaitingRetry: return "waiting_retry";
+        default: return "idle";
+    }
+}
+
+unsigned long NetworkManager::getRetryIn() const {
+    if (getWiFiState() != WiFiState::WaitingRetry) {
+        return 0;
+    }
+    long remaining = (long)(retryAt.load() - millis());
+    return remaining > 0 ? remaining : 0;
 }
 
 void NetworkManager::clearWiFiCredentials() {
@@ -238,8 +461,9 @@ String NetworkManager::getConnectionStatus() const {
     JsonDocument doc;
     
     doc["ap_mode"] = isAPMode;
-    doc["sta_connected"] = isSTAConnected;
-    doc["internet_connected"] = internetConnected;
+    doc["sta_connected"] = isSTAConnected.load();
+    doc["wifi_state"] = getWiFiStateName(getWiFiState());
+    doc["internet_connected"] = internetConnected.load();
     
     if (isAPMode) {
         doc["ap_ssid"] = apSSID;
@@ -254,8 +478,9 @@ String NetworkManager::getConnectionStatus() const {
     }
     
     doc["wifi_configured"] = wifiConfig.isConfigured;
-    doc["reconnect_attempts"] = reconnectAttempts;
-    doc["last_internet_check"] = lastInternetCheck;
+    doc["reconnect_attempts"] = reconnectAttempts.load();
+    doc["retry_in_ms"] = getRetryIn();
+    doc["last_internet_check"] = lastProbeTime.load();
     
     String result;
     serializeJson(doc, result);
@@ -298,17 +523,77 @@ int NetworkManager::getSignalStrength() const {
 }
 
 void NetworkManager::handleTasks() {
-    // Check WiFi connection status
-    if (isSTAConnected && WiFi.status() != WL_CONNECTED) {
-        Serial.println("WiFi connection lost");
-        isSTAConnected = false;
-        internetConnected = false; // Also mark internet as disconnected
+    applyPendingRequest();
+    unsigned long now = millis();
+    
+    if (eventDisconnected.exchange(false)) {
+        WiFiState state = getWiFiState();
+        if (state == WiFiState::Connected) {
+            Serial.printf("WiFi connection lost (reason %u)\n", lastDisconnectReason.load());
+            isSTAConnected = false;
+            internetConnected = false; // Also mark internet as disconnected
+            
+            // Reconnect straight away; backoff only applies to failed attempts
+            reconnectAttempts = 0;
+            if (!targetSSID.isEmpty()) {
+                beginAttempt();
+            } else {
+                setWiFiState(WiFiState::Idle);
+            }
+        } else if (state == WiFiState::Connecting) {
+            char why[24];
+            snprintf(why, sizeof(why), "reason %u", lastDisconnectReason.load());
+            attemptFailed(why);
+        }
+    }
+    
+    // Confirm against the driver: a disconnect may have followed the event
+    if (eventGotIP.exchange(false) && WiFi.status() == WL_CONNECTED && getWiFiState() != WiFiState::Connected) {
+        isSTAConnected = true;
+        lastConnectionAttempt = now;
+        reconnectAttempts = 0;
+        if (targetSSID.isEmpty()) {
+            targetSSID = WiFi.SSID(); // Joined outside connectToWiFi()
+        }
+        
+        Serial.printf("WiFi connected successfully!\n");
+        Serial.printf("IP address: %s\n", WiFi.localIP().toString().c_str());
+        Serial.printf("Signal strength: %d dBm\n", WiFi.RSSI());
         
-        // Attempt to reconnect if we have credentials
-        if (wifiConfig.isConfigured && millis() - lastConnectionAttempt > 30000) {
-            Serial.println("Attempting to reconnect to WiFi...");
-            connectToWiFi();
+        if (saveOnConnect) {
+            wifiConfig.ssid = targetSSID;
+            wifiConfig.password = targetPassword;
+            wifiConfig.isConfigured = true;
+            saveWiFiConfig();
+            saveOnConnect = false;
+            credentialsConfirmed = true;
+            fallbackPassword = "";
+            Serial.printf("WiFi credentials saved and tested successfully: %s\n", targetSSID.c_str());
         }
+        
+        setWiFiState(WiFiState::Connected);
+        requestInternetProbe();
+    }
+    
+    if (scanInProgress) {
+        if (eventScanDone.exchange(false)) {
+            collectScanResults();
+        } else if ((long)(now - scanStartedAt.load()) > (long)SCAN_TIMEOUT) {
+            Serial.println("WiFi scan timed out");
+            WiFi.scanDelete();
+            finishScan(true);
+        }
+    }
+    
+    // The branches above may have started an attempt after 'now' was read,
+    // so take a fresh time and compare signed
+    now = millis();
+    WiFiState state = getWiFiState();
+    if (state == WiFiState::Connecting && (long)(now - stateSince) > (long)connectionTimeout) {
+        WiFi.disconnect();
+        attemptFailed("timeout");
+    } else if (state == WiFiState::WaitingRetry && (long)(now - retryAt.load()) >= 0) {
+        beginAttempt();
     }
 }
 
@@ -361,31 +646,135 @@ void NetworkManager::switchToSTAMode() {
     }
 }
 
-String NetworkManager::scanNetworks() {
+bool NetworkManager::startScan() {
+    if (scanInProgress) {
+        return false;
+    }
+    
+    // Stamp before raising the flag so handleTasks() never times out a new
+    // scan against the previous start time
+    scanStartedAt = millis();
+    eventScanDone = false;
+    if (scanInProgress.exchange(true)) {
+        return false;
+    }
+    // async=true, show_hidden=false, passive=false, max_ms_per_chan=300
+    if (WiFi.scanNetworks(true, false, false, 300) == WIFI_SCAN_FAILED) {
+        Serial.println("WiFi scan failed to start");
+        scanFailed = true;
+        scanInProgress = false;
+        return false;
+    }
+    
     Serial.println("Scanning for WiFi networks...");
+    return true;
+}
+
+// Loop context, after the scan-done event
+void NetworkManager::collectScanResults() {
+    int16_t found = WiFi.scanComplete();
+    if (found < 0) {
+        Serial.println("WiFi scan failed");
+        WiFi.scanDelete();
+        finishScan(true);
+        return;
+    }
     
-    int networkCount = WiFi.scanNetworks();
+    WiFiScanCache cache;
+    memset(&cache, 0, sizeof(cache));
+    cache.found = found;
+    
+    // Insert each result into the strongest-first list, dropping whatever
+    // falls off the end
+    for (int16_t i = 0; i < found; i++) {
+        int8_t rssi = (int8_t)WiFi.RSSI(i);
+        int slot = cache.count;
+        while (slot > 0 && cache.networks[slot - 1].rssi < rssi) {
+            slot--;
+        }
+        if (slot >= SCAN_CACHE_SIZE) {
+            continue;
+        }
+        
+        int last = (cache.count < SCAN_CACHE_SIZE) ? cache.count : SCAN_CACHE_SIZE - 1;
+        memmove(&cache.networks[slot + 1], &cache.networks[slot], (last - slot) * sizeof(ScanNetwork));
+        
+        ScanNetwork& network = cache.networks[slot];
+        strlcpy(network.ssid, WiFi.SSID(i).c_str(), sizeof(network.ssid));
+        network.rssi = rssi;
+        network.channel = (uint8_t)WiFi.channel(i);
+        network.authMode = (uint8_t)WiFi.encryptionType(i);
+        if (cache.count < SCAN_CACHE_SIZE) {
+            cache.count++;
+        }
+    }
+    
+    WiFi.scanDelete(); // Clean up scan results
+    cache.completedAt = millis();
+    scanCache.write(cache);
+    
+    Serial.printf("Found %d networks, keeping the %d strongest\n", found, cache.count);
+    finishScan(false);
+}
+
+void NetworkManager::finishScan(bool failed) {
+    scanFailed = failed;
+    scanInProgress = false;
+    if (scanCallback != nullptr) {
+        WiFiScanCache cache;
+        if (scanCache.read(cache)) {
+            scanCallback(cache, failed);
+        }
+    }
+}
+
+const char* NetworkManager::getAuthModeName(uint8_t authMode) {
+    switch (authMode) {
+        case WIFI_AUTH_OPEN: return "Open";
+        case WIFI_AUTH_WEP: return "WEP";
+        case WIFI_AUTH_WPA_PSK: return "WPA";
+        case WIFI_AUTH_WPA2_PSK: return "WPA2";
+        case WIFI_AUTH_WPA_WPA2_PSK: return "WPA/WPA2";
+        case WIFI_AUTH_WPA2_ENTERPRISE: return "WPA2-Enterprise";
+        case WIFI_AUTH_WPA3_PSK: return "WPA3";
+        case WIFI_AUTH_WPA2_WPA3_PSK: return "WPA2/WPA3";
+        default: return "Encrypted";
+    }
+}
+
+String NetworkManager::scanNetworks() {
+    WiFiScanCache cache;
+    if (!scanCache.read(cache)) {
+        cache.count = 0;
+        cache.found = 0;
+        cache.completedAt = 0;
+    }
+    
+    // Nothing cached yet: start one for the next caller
+    if (cache.completedAt == 0) {
+        startScan();
+    }
     
     JsonDocument doc;
     JsonArray networks = doc["networks"].to<JsonArray>();
     
-    if (networkCount == 0) {
-        doc["count"] = 0;
+    doc["count"] = cache.found;
+    doc["scanning"] = isScanInProgress();
+    if (cache.completedAt != 0) {
+        doc["age_ms"] = millis() - cache.completedAt;
+    }
+    if (cache.count == 0) {
         doc["message"] = "No networks found";
-    } else {
-        doc["count"] = networkCount;
-        
-        for (int i = 0; i < networkCount; i++) {
-            JsonObject network = networks.add<JsonObject>();
-            network["ssid"] = WiFi.SSID(i);
-            network["rssi"] = WiFi.RSSI(i);
-            network["encryption"] = (WiFi.encryptionType(i) == WIFI_AUTH_OPEN) ? "Open" : "Encrypted";
-        }
     }
     
-    WiFi.scanDelete(); // Clean up scan results
+    for (int i = 0; i < cache.count; i++) {
+        JsonObject network = networks.add<JsonObject>();
+        network["ssid"] = cache.networks[i].ssid;
+        network["rssi"] = cache.networks[i].rssi;
+        network["encryption"] = (cache.networks[i].authMode == WIFI_AUTH_OPEN) ? "Open" : "Encrypted";
+    }
     
     String result;
     serializeJson(doc, result);
     return result;
-}
\ No newline at end of file
+}
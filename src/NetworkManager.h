@@ -6,6 +6,47 @@
 #include <ArduinoJson.h>
 #include <WiFiClient.h>
 #include <HTTPClient.h>
+#include <atomic>
+#include "SeqLock.h"
+
+// Connectivity probe target; override with a build flag to point the prober
+// at a local stand-in server, e.g.
+// -DINTERNET_PROBE_URL=\"http://192.168.4.2:8000/generate_204\"
+#ifndef INTERNET_PROBE_URL
+#define INTERNET_PROBE_URL "http://connectivitycheck.gstatic.com/generate_204"
+#endif
+
+// Station connection state, driven by WiFi events (see handleTasks())
+enum class WiFiState : uint8_t {
+    Idle = 0,       // No network to join
+    Connecting,     // WiFi.begin() issued, waiting for an address
+    Connected,
+    WaitingRetry    // Attempt failed or the link dropped; retrying after a backoff
+};
+
+// Called from handleTasks() (loop context) on every state change
+typedef void (*WiFiStateCallback)(WiFiState state, const String& ssid);
+
+// Networks kept from a scan, strongest first
+const int SCAN_CACHE_SIZE = 20;
+
+struct ScanNetwork {
+    char ssid[33];
+    int8_t rssi;
+    uint8_t channel;
+    uint8_t authMode;       // wifi_auth_mode_t
+};
+
+// Last completed scan. Fixed size so it can be published through a SeqLock
+struct WiFiScanCache {
+    ScanNetwork networks[SCAN_CACHE_SIZE];
+    uint8_t count;          // Kept, at most SCAN_CACHE_SIZE
+    uint16_t found;         // Reported by the scan
+    uint32_t completedAt;   // millis(); 0 = no scan has completed
+};
+
+// Called from handleTasks() (loop context) when a scan finishes or fails
+typedef void (*WiFiScanCallback)(const WiFiScanCache& cache, bool failed);
 
 struct WiFiConfig {
     String ssid;
@@ -27,18 +68,79 @@ private:
     
     // WiFi status tracking
     bool isAPMode;
-    bool isSTAConnected;
+    std::atomic<bool> isSTAConnected;
     unsigned long lastConnectionAttempt;
-    unsigned long connectionTimeout;
-    int reconnectAttempts;
+    unsigned long connectionTimeout;                    // Per attempt
+    std::atomic<int> reconnectAttempts;                 // Since the last successful connection
+    
+    // Station state machine. The WiFi event handler (event task) only posts
+    // flags; handleTasks() in loop() owns transitions, retries and callbacks,
+    // so no caller ever waits on the radio
+    std::atomic<uint8_t> wifiState;                     // WiFiState
+    std::atomic<bool> eventGotIP;
+    std::atomic<bool> eventDisconnected;
+    std::atomic<uint8_t> lastDisconnectReason;          // wifi_err_reason_t
+    std::atomic<uint32_t> retryAt;                      // millis() of the next attempt
+    String targetSSID;
+    String targetPassword;
+    bool saveOnConnect;                                 // Credentials waiting to be confirmed
+    String fallbackSSID;                                // Network to return to if they fail
+    String fallbackPassword;
+    bool credentialsConfirmed;                          // Until takeConfirmedCredentials()
+    unsigned long stateSince;
+    wifi_event_id_t wifiEventHandle;
+    WiFiStateCallback stateCallback;
+    const unsigned long RETRY_MIN = 1000;               // After a failed attempt, doubling...
+    const unsigned long RETRY_MAX = 60000;              // ...up to a minute
+    
+    // Connect/save/disconnect calls may come from web handlers; they only
+    // post the latest request here and handleTasks() applies it
+    enum class WiFiRequest : uint8_t { None = 0, Connect, Save, Disconnect };
+    SemaphoreHandle_t requestMutex;
+    WiFiRequest pendingRequest;                         // Guarded by requestMutex
+    String pendingSSID;                                 // Guarded by requestMutex
+    String pendingPassword;                             // Guarded by requestMutex
+    std::atomic<bool> requestPosted;
     
-    // NEW: Internet connectivity tracking
-    bool internetConnected;
-    unsigned long lastInternetCheck;
-    const unsigned long INTERNET_CHECK_INTERVAL = 30000; // Check every 30 seconds
+    // Background scan. Started from any task, collected by handleTasks() on
+    // the scan-done event and published for readers on any task
+    SeqLock<WiFiScanCache> scanCache;
+    std::atomic<bool> scanInProgress;
+    std::atomic<bool> scanFailed;                       // The last scan failed; cache is older
+    std::atomic<bool> eventScanDone;
+    std::atomic<uint32_t> scanStartedAt;
+    WiFiScanCallback scanCallback;
+    const unsigned long SCAN_TIMEOUT = 15000;
+    
+    // Internet connectivity: loop() schedules probes, a background task runs
+    // them and caches the result, so a bad uplink never blocks the caller
+    String probeUrl;
+    TaskHandle_t probeTask;
+    unsigned long lastInternetCheck;                    // loop() side scheduling
+    std::atomic<bool> internetConnected;
+    std::atomic<bool> probeInFlight;
+    std::atomic<uint32_t> lastProbeTime;                // millis() when the last probe finished
+    std::atomic<uint32_t> lastProbeLatency;             // ms
+    std::atomic<int> lastProbeCode;                     // HTTP code, or negative HTTPClient error
+    std::atomic<uint32_t> probeFailures;                // Consecutive
+    std::atomic<uint32_t> probeInterval;                // Until the next probe, adapted per result
+    const unsigned long INTERNET_CHECK_INTERVAL = 30000; // While the uplink is healthy
+    const unsigned long PROBE_RETRY_MIN = 5000;          // First retry after a failure, doubling...
+    const unsigned long PROBE_RETRY_MAX = 300000;        // ...up to 5 minutes
+    const uint16_t PROBE_TIMEOUT_MS = 5000;
     
     void loadWiFiConfig();
     void saveWiFiConfig();
+    static void probeTaskEntry(void* arg);
+    void runProbe();
+    void onWiFiEvent(arduino_event_id_t event, arduino_event_info_t info);
+    void postRequest(WiFiRequest request, const String& ssid, const String& password);
+    void applyPendingRequest();
+    void beginAttempt();
+    void attemptFailed(const char* why);
+    void setWiFiState(WiFiState state);
+    void collectScanResults();
+    void finishScan(bool failed);
 
 public:
     NetworkManager();
@@ -50,15 +152,26 @@ public:
     String getAPSSID() const { return String(apSSID); }
     IPAddress getAPIP() const { return apIP; }
     
-    // Station functions
+    // Station functions, safe from any task. They post a request that the next
+    // handleTasks() applies; the outcome arrives through the state callback,
+    // and dropped links are retried with backoff until disconnectWiFi()
     bool connectToWiFi();
     bool connectToWiFi(const String& ssid, const String& password);
     void disconnectWiFi();
     bool isWiFiConnected() const { return isSTAConnected; }
     String getWiFiSSID() const { return wifiConfig.ssid; }
+    WiFiState getWiFiState() const { return static_cast<WiFiState>(wifiState.load()); }
+    static const char* getWiFiStateName(WiFiState state);
+    void onWiFiStateChange(WiFiStateCallback callback) { stateCallback = callback; }
+    int getReconnectAttempts() const { return reconnectAttempts; }
+    uint8_t getLastDisconnectReason() const { return lastDisconnectReason; }
+    unsigned long getRetryIn() const;                   // 0 unless waiting to retry
     
-    // Configuration management
+    // Configuration management. Credentials are stored once a connection with
+    // them succeeds; a failed attempt falls back to the network in use before
     bool saveWiFiCredentials(const String& ssid, const String& password);
+    bool takeConfirmedCredentials(WiFiConfig& out);     // Loop context; true once per confirmed save
+    bool isRequestPending() const { return requestPosted; }
     WiFiConfig getWiFiConfig() const { return wifiConfig; }
     bool hasWiFiCredentials() const { return wifiConfig.isConfigured; }
     void clearWiFiCredentials();
@@ -68,12 +181,24 @@ public:
     String getNetworkInfo() const;
     int getSignalStrength() const;
     
-    // NEW: Internet connectivity functions
-    bool isInternetConnected() const { return internetConnected; }
+    // Internet connectivity. checkInternetConnectivity() never blocks: it
+    // wakes the probe task when a probe is due and returns the cached result.
+    bool beginInternetProbe();                           // Starts the probe task (call once)
+    void setProbeUrl(const String& url) { probeUrl = url; }   // Before beginInternetProbe()
+    const String& getProbeUrl() const { return probeUrl; }
     void checkInternetConnectivity();
+    void requestInternetProbe();                         // Probe now, unless one is running
+    bool isInternetConnected() const { return internetConnected; }
+    bool isProbeInFlight() const { return probeInFlight; }
+    uint32_t getLastProbeTime() const { return lastProbeTime; }      // 0 = never probed
+    uint32_t getLastProbeLatency() const { return lastProbeLatency; }
+    int getLastProbeCode() const { return lastProbeCode; }
+    uint32_t getProbeFailures() const { return probeFailures; }
+    uint32_t getProbeInterval() const { return probeInterval; }
+    unsigned long getNextProbeIn() const;
     bool pingGoogle(); // Alternative ping method
     
-    // Task handling
+    // Task handling: runs the connection state machine, call from loop()
     void handleTasks();
     
     // AP+STA mode management
@@ -82,8 +207,15 @@ public:
     void switchToSTAMode();
     bool isInAPMode() const { return isAPMode; }
     
-    // Network scanning
-    String scanNetworks();
+    // Network scanning. startScan() returns at once; results replace the cache
+    // when the scan completes, after which the scan callback fires
+    bool startScan();                                   // False if one is running or it failed to start
+    bool isScanInProgress() const { return scanInProgress; }
+    bool didLastScanFail() const { return scanFailed; }
+    bool getScanResults(WiFiScanCache& out) const { return scanCache.read(out); }
+    void onScanComplete(WiFiScanCallback callback) { scanCallback = callback; }
+    static const char* getAuthModeName(uint8_t authMode);
+    String scanNetworks();                              // Cached results as JSON; never waits for the radio
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,90 @@
+#include "PeakDetector.h"
+
+PeakDetector::PeakDetector() {
+    reset(0);
+}
+
+void PeakDetector::reset(float newProminence) {
+    prominence = newProminence;
+    seekingPeak = false; // The signal starts at rest, so the first extremum is a trough
+    hasSamples = false;
+    candidateValue = 0;
+    candidateTime = 0;
+    beforeValue = 0;
+    beforeTime = 0;
+    afterValue = 0;
+    afterTime = 0;
+    hasAfter = false;
+    lastValue = 0;
+    lastTime = 0;
+}
+
+void PeakDetector::startCandidate(float value, unsigned long timestamp) {
+    beforeValue = hasSamples ? lastValue : value;
+    beforeTime = hasSamples ? lastTime : timestamp;
+    candidateValue = value;
+    candidateTime = timestamp;
+    hasAfter = false;
+}
+
+Extremum PeakDetector::interpolate() const {
+    Extremum extremum;
+    extremum.isPeak = seekingPeak;
+    extremum.amplitude = candidateValue;
+    extremum.time = candidateTime;
+
+    if (!hasAfter || beforeTime == candidateTime) {
+        return extremum;
+    }
+
+    // Vertex of the parabola through (before, candidate, after)
+    float curvature = beforeValue - 2 * candidateValue + afterValue;
+    if (curvature == 0) {
+        return extremum;
+    }
+
+    float offset = 0.5f * (beforeValue - afterValue) / curvature; // In samples, within [-0.5, 0.5]
+    offset = max(-0.5f, min(offset, 0.5f));
+
+    float spacing = (offset >= 0) ? (float)(afterTime - candidateTime) : (float)(candidateTime - beforeTime);
+    extremum.time = candidateTime + lroundf(offset * spacing);
+    extremum.amplitude = candidateValue - 0.25f * (beforeValue - afterValue) * offset;
+    return extremum;
+}
+
+bool PeakDetector::push(float value, unsigned long timestamp, Extremum& extremum) {
+    if (!hasSamples) {
+        startCandidate(value, timestamp);
+        hasSamples = true;
+        lastValue = value;
+        lastTime = timestamp;
+        return false;
+    }
+
+    bool confirmed = false;
+    bool extendsCandidate = seekingPeak ? (value > candidateValue) : (value < candidateValue);
+
+    if (extendsCandidate) {
+        startCandidate(value, timestamp);
+    } else {
+        if (!hasAfter) {
+            afterValue = value;
+            afterTime = timestamp;
+            hasAfter = true;
+        }
+
+        float retreat = seekingPeak ? (candidateValue - value) : (value - candidateValue);
+        if (retreat >= prominence) {
+            extremum = interpolate();
+            confirmed = true;
+
+            // Look for the opposite extremum, starting from the current sample
+            seekingPeak = !seekingPeak;
+            startCandidate(value, timestamp);
+        }
+    }
+
+    lastValue = value;
+    lastTime = timestamp;
+    return confirmed;
+}
@@ -0,0 +1,51 @@
+#ifndef PEAK_DETECTOR_H
+#define PEAK_DETECTOR_H
+
+#include <Arduino.h>
+
+// Local maximum or minimum located between samples
+struct Extremum {
+    bool isPeak = false;        // true = maximum, false = minimum
+    float amplitude = 0;        // Parabola vertex value
+    unsigned long time = 0;     // Vertex time in ms (sub-sample resolution)
+};
+
+// Alternating peak/trough detector based on derivative sign changes.
+// A candidate extremum is confirmed once the signal has moved back by at
+// least 'prominence', which rejects ADC noise without a smoothing delay.
+// The confirmed extremum is refined with a parabola through the candidate
+// sample and its two neighbours.
+class PeakDetector {
+private:
+    float prominence;
+    bool seekingPeak;
+    bool hasSamples;
+
+    // Candidate extremum and its neighbours
+    float candidateValue;
+    unsigned long candidateTime;
+    float beforeValue;
+    unsigned long beforeTime;
+    float afterValue;
+    unsigned long afterTime;
+    bool hasAfter;
+
+    float lastValue;
+    unsigned long lastTime;
+
+    void startCandidate(float value, unsigned long timestamp);
+    Extremum interpolate() const;
+
+public:
+    PeakDetector();
+    void reset(float newProminence);
+
+    // Feed one sample; returns true and fills 'extremum' when the previous
+    // candidate is confirmed. The detector then looks for the opposite kind.
+    bool push(float value, unsigned long timestamp, Extremum& extremum);
+
+    bool isSeekingPeak() const { return seekingPeak; }
+    unsigned long getCandidateTime() const { return candidateTime; }
+};
+
+#endif
@@ -0,0 +1,177 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stddef.h>
+
+// Fixed-capacity circular window with a running sum.
+// Storage is inline (no heap); the active capacity can be lowered at runtime
+// up to MaxCapacity. Pushing into a full window evicts the oldest value.
+template <typename T, size_t MaxCapacity>
+class RingBuffer {
+    static_assert(MaxCapacity > 0, "RingBuffer needs a non-zero capacity");
+
+private:
+    T buffer[MaxCapacity];
+    size_t capacity;
+    size_t head;       // Index of the oldest element
+    size_t count;
+    T runningSum;
+
+    // Re-add the window from scratch so float rounding cannot accumulate.
+    // Called once per full wrap, which keeps push() amortised O(1).
+    void resyncSum() {
+        T sum = 0;
+        for (size_t i = 0; i < count; i++) {
+            sum += buffer[(head + i) % capacity];
+        }
+        runningSum = sum;
+    }
+
+public:
+    RingBuffer() : capacity(MaxCapacity), head(0), count(0), runningSum(0) {}
+
+    // Clamps to [1, MaxCapacity] and clears the window
+    void setCapacity(size_t newCapacity) {
+        if (newCapacity < 1) newCapacity = 1;
+        if (newCapacity > MaxCapacity) newCapacity = MaxCapacity;
+        capacity = newCapacity;
+        clear();
+    }
+
+    void clear() {
+        head = 0;
+        count = 0;
+        runningSum = 0;
+    }
+
+    void push(T value) {
+        if (count < capacity) {
+            buffer[(head + count) % capacity] = value;
+            count++;
+            runningSum += value;
+            return;
+        }
+
+        runningSum -= buffer[head];
+        buffer[head] = value;
+        runningSum += value;
+        head++;
+        if (head == capacity) {
+            head = 0;
+            resyncSum();
+        }
+    }
+
+    // 0 is the oldest element, size() - 1 the newest
+    T operator[](size_t index) const { return buffer[(head + index) % capacity]; }
+    T oldest() const { return buffer[head]; }
+    T newest() const { return buffer[(head + count - 1) % capacity]; }
+
+    size_t size() const { return count; }
+    size_t getCapacity() const { return capacity; }
+    bool empty() const { return count == 0; }
+    bool full() const { return count == capacity; }
+
+    T sum() const { return runningSum; }
+    T average() const { return count > 0 ? runningSum / (T)count : 0; }
+};
+
+// Window whose capacity is a compile-time constant: wrapping is a compare
+// instead of a modulo, and the average divides by a constant once full.
+template <typename T, size_t Capacity>
+class FixedWindow {
+    static_assert(Capacity > 0, "FixedWindow needs a non-zero capacity");
+
+private:
+    T buffer[Capacity];
+    size_t next;       // Slot the next push writes
+    size_t count;
+    T runningSum;
+
+public:
+    FixedWindow() : next(0), count(0), runningSum(0) {}
+
+    void clear() {
+        next = 0;
+        count = 0;
+        runningSum = 0;
+    }
+
+    void push(T value) {
+        if (count < Capacity) {
+            count++;
+        } else {
+            runningSum -= buffer[next];
+        }
+        buffer[next] = value;
+        runningSum += value;
+
+        if (++next == Capacity) {
+            next = 0;
+            // Same once-per-wrap resync as RingBuffer
+            T sum = 0;
+            for (size_t i = 0; i < count; i++) {
+                sum += buffer[i];
+            }
+            runningSum = sum;
+        }
+    }
+
+    size_t size() const { return count; }
+    bool full() const { return count == Capacity; }
+    T sum() const { return runningSum; }
+    T average() const { return (count == Capacity) ? runningSum / (T)Capacity : (count > 0 ? runningSum / (T)count : 0); }
+};
+
+// First-in first-out queue of records (no running sum). Pushing into a full
+// queue drops the oldest record and counts it in dropped().
+template <typename T, size_t Capacity>
+class EventQueue {
+    static_assert(Capacity > 0, "EventQueue needs a non-zero capacity");
+
+private:
+    T buffer[Capacity];
+    size_t head;       // Oldest record
+    size_t count;
+    size_t droppedCount;
+
+public:
+    EventQueue() : head(0), count(0), droppedCount(0) {}
+
+    void clear() {
+        head = 0;
+        count = 0;
+        droppedCount = 0;
+    }
+
+    void push(const T& value) {
+        size_t tail = head + count;
+        if (tail >= Capacity) {
+            tail -= Capacity;
+        }
+        buffer[tail] = value;
+
+        if (count < Capacity) {
+            count++;
+        } else {
+            head = (head + 1 == Capacity) ? 0 : head + 1;
+            droppedCount++;
+        }
+    }
+
+    bool pop(T& value) {
+        if (count == 0) {
+            return false;
+        }
+        value = buffer[head];
+        head = (head + 1 == Capacity) ? 0 : head + 1;
+        count--;
+        return true;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t dropped() const { return droppedCount; }
+};
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef SAMPLE_TIMING_MONITOR_H
+#define SAMPLE_TIMING_MONITOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Field evidence for the sample clock. Every sample timestamp is compared
+// with the previous one: the deviation of the interval from the nominal
+// period goes into a histogram with roughly logarithmic bins (so both a few
+// microseconds of ISR latency and a multi-millisecond stall are visible), and
+// an interval longer than 1.5 periods counts the skipped sample slots as
+// missed deadlines.
+//
+// record() is called by the acquisition task; the counters are atomics so
+// HTTP handlers can read them from any task while sampling continues.
+class SampleTimingMonitor {
+public:
+    static constexpr size_t BIN_COUNT = 14;
+
+    // Upper edge (exclusive, us) of each deviation bin; the last bin is open
+    static const int32_t* binEdges() {
+        static const int32_t EDGES[BIN_COUNT - 1] = {
+            -5000, -1000, -200, -50, -10, -2, 2, 10, 50, 200, 1000, 5000, 20000
+        };
+        return EDGES;
+    }
+
+    struct Snapshot {
+        uint32_t periodMicros = 0;
+        uint32_t intervals = 0;
+        uint32_t missedDeadlines = 0;
+        uint32_t minIntervalMicros = 0;
+        uint32_t maxIntervalMicros = 0;
+        float meanAbsJitterMicros = 0;
+        uint32_t bins[BIN_COUNT] = {};
+    };
+
+private:
+    std::atomic<uint32_t> periodMicros;
+    std::atomic<uint32_t> intervals;
+    std::atomic<uint32_t> missed;
+    std::atomic<uint32_t> minInterval;
+    std::atomic<uint32_t> maxInterval;
+    std::atomic<uint32_t> absJitterSum;      // us, saturating
+    std::atomic<uint32_t> bins[BIN_COUNT];
+    std::atomic<bool> resetRequested;
+    int64_t lastTimestamp;                   // Producer-only
+
+    static size_t binFor(int32_t deviation) {
+        const int32_t* edges = binEdges();
+        size_t bin = 0;
+        while (bin < BIN_COUNT - 1 && deviation >= edges[bin]) {
+            bin++;
+        }
+        return bin;
+    }
+
+    void clearCounters() {
+        intervals.store(0);
+        missed.store(0);
+        minInterval.store(UINT32_MAX);
+        maxInterval.store(0);
+        absJitterSum.store(0);
+        for (size_t i = 0; i < BIN_COUNT; i++) {
+            bins[i].store(0);
+        }
+    }
+
+public:
+    SampleTimingMonitor() : periodMicros(0), resetRequested(false), lastTimestamp(-1) {
+        clearCounters();
+    }
+
+    // Producer side: new nominal period; restarts the statistics
+    void configure(uint32_t period) {
+        periodMicros.store(period);
+        clearCounters();
+        lastTimestamp = -1;
+    }
+
+    // Any task: the producer clears the counters before its next record()
+    void requestReset() { resetRequested.store(true); }
+
+    // Producer side, once per sample
+    void record(int64_t timestampMicros) {
+        if (resetRequested.exchange(false)) {
+            clearCounters();
+            lastTimestamp = -1;
+        }
+        if (lastTimestamp < 0) {
+            lastTimestamp = timestampMicros;
+            return;
+        }
+
+        int64_t interval = timestampMicros - lastTimestamp;
+        lastTimestamp = timestampMicros;
+        uint32_t period = periodMicros.load(std::memory_order_relaxed);
+        if (interval < 0 || period == 0) {
+            return;
+        }
+
+        uint32_t clamped = interval > (int64_t)UINT32_MAX ? UINT32_MAX : (uint32_t)interval;
+        int64_t deviation = interval - period;
+        int32_t clampedDeviation = deviation > INT32_MAX ? INT32_MAX : (int32_t)deviation;
+
+        bins[binFor(clampedDeviation)].fetch_add(1, std::memory_order_relaxed);
+        intervals.fetch_add(1, std::memory_order_relaxed);
+        if (clamped < minInterval.load(std::memory_order_relaxed)) {
+            minInterval.store(clamped, std::memory_order_relaxed);
+        }
+        if (clamped > maxInterval.load(std::memory_order_relaxed)) {
+            maxInterval.store(clamped, std::memory_order_relaxed);
+        }
+
+        uint32_t absDeviation = (uint32_t)(deviation < 0 ? -deviation : deviation);
+        uint32_t sum = absJitterSum.load(std::memory_order_relaxed);
+        absJitterSum.store(sum + absDeviation < sum ? UINT32_MAX : sum + absDeviation, std::memory_order_relaxed);
+
+        // Every whole period beyond the first is a sample slot that was skipped
+        if (2 * (uint64_t)interval > 3 * (uint64_t)period) {
+            missed.fetch_add((uint32_t)((interval + period / 2) / period - 1), std::memory_order_relaxed);
+        }
+    }
+
+    // Any task
+    Snapshot read() const {
+        Snapshot snapshot;
+        snapshot.periodMicros = periodMicros.load();
+        snapshot.intervals = intervals.load();
+        snapshot.missedDeadlines = missed.load();
+        snapshot.maxIntervalMicros = maxInterval.load();
+        uint32_t minValue = minInterval.load();
+        snapshot.minIntervalMicros = (minValue == UINT32_MAX) ? 0 : minValue;
+        if (snapshot.intervals > 0) {
+            snapshot.meanAbsJitterMicros = (float)absJitterSum.load() / snapshot.intervals;
+        }
+        for (size_t i = 0; i < BIN_COUNT; i++) {
+            snapshot.bins[i] = bins[i].load();
+        }
+        return snapshot;
+    }
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef SEQ_LOCK_H
+#define SEQ_LOCK_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <string.h>
+#include <type_traits>
+
+// Single-writer, multi-reader published value. The writer never blocks: it
+// bumps the sequence to odd, copies the value in and bumps it back to even.
+// Readers copy the value out and retry if the sequence was odd or changed
+// while they were copying, so they always return a consistent snapshot.
+//
+// A reader that preempts the writer mid-copy (same core, higher priority)
+// sleeps a tick between retries so the writer can finish.
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock values are copied with memcpy");
+
+private:
+    std::atomic<uint32_t> sequence;
+    T value;
+
+public:
+    SeqLock() : sequence(0), value() {}
+
+    // Writer side: call from the owning task only
+    void write(const T& newValue) {
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&value, &newValue, sizeof(T));
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    // Returns false (out untouched or partial) if no consistent copy was
+    // obtained within maxAttempts
+    bool read(T& out, int maxAttempts = 20) const {
+        for (int attempt = 0; attempt < maxAttempts; attempt++) {
+            uint32_t before = sequence.load(std::memory_order_acquire);
+            if ((before & 1) == 0) {
+                memcpy(&out, &value, sizeof(T));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence.load(std::memory_order_relaxed) == before) {
+                    return true;
+                }
+            }
+            delay(1);
+        }
+        return false;
+    }
+
+    // Number of completed writes
+    uint32_t version() const { return sequence.load(std::memory_order_acquire) / 2; }
+};
+
+#endif
@@ -0,0 +1,243 @@
+#include "SessionReplay.h"
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+// CSV columns written by writeCSVData()
+enum CSVColumn {
+    COL_CHIP_ID = 0,
+    COL_SESSION_ID,
+    COL_TIMESTAMP,
+    COL_RAW_VALUE,
+    COL_SCALED_VALUE,
+    COL_STATE,
+    COL_REQUIRED    // Columns after State are recomputed, not read
+};
+
+// Inverse of cprStateToString()
+bool parseState(const char* text, size_t length, CPRState& state) {
+    if (length == 11 && strncmp(text, "compression", length) == 0) {
+        state = CPRState::Compression;
+    } else if (length == 6 && strncmp(text, "recoil", length) == 0) {
+        state = CPRState::Recoil;
+    } else if (length == 5 && strncmp(text, "pause", length) == 0) {
+        state = CPRState::Quietude;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parseUnsigned(const char* text, const char* end, unsigned long& value) {
+    char* parsed;
+    value = strtoul(text, &parsed, 10);
+    return parsed != text && parsed == end;
+}
+
+} // namespace
+
+SessionReplayer::SessionReplayer(const CPRThresholds& thresholds) : lastRowTimestamp(0), lastRowValue(0) {
+    setParams(thresholds);
+    begin();
+}
+
+void SessionReplayer::setParams(const CPRThresholds& thresholds) {
+    params = thresholds;
+    // Rows are filled back up to the feature rate; do not decimate them again
+    params.sampleRateHz = params.featureRateHz;
+    featurePeriodMs = 1000UL / max(1, params.featureRateHz);
+}
+
+void SessionReplayer::begin() {
+    blockCount = 0;
+    resultCount = 0;
+    current = nullptr;
+    stats = ReplayStats();
+    startMicros = micros();
+}
+
+void SessionReplayer::startSession(int sessionId, unsigned long timestamp) {
+    if (resultCount == MAX_SESSIONS) {
+        // Keep the most recent sessions
+        for (size_t i = 1; i < MAX_SESSIONS; i++) {
+            results[i - 1] = results[i];
+        }
+        resultCount--;
+    }
+
+    current = &results[resultCount++];
+    *current = ReplaySessionResult();
+    current->sessionId = sessionId;
+    current->firstTimestamp = timestamp;
+    lastRowTimestamp = timestamp;
+    stats.sessions++;
+
+    calculator.updateParams(params);
+    calculator.setRunning(true);
+}
+
+bool SessionReplayer::feedLine(const char* line) {
+    stats.lines++;
+
+    // Split into the leading columns we need
+    const char* fields[COL_REQUIRED];
+    const char* ends[COL_REQUIRED];
+    size_t column = 0;
+    const char* start = line;
+    for (const char* p = line; column < COL_REQUIRED; p++) {
+        if (*p == ',' || *p == '\0' || *p == '\r' || *p == '\n') {
+            fields[column] = start;
+            ends[column] = p;
+            column++;
+            if (*p != ',') {
+                break;
+            }
+            start = p + 1;
+        }
+    }
+
+    if (column == 0 || ends[0] == fields[0]) {
+        return true; // Blank line
+    }
+    if (strncmp(line, "ChipID", 6) == 0) {
+        return true; // Header (repeated whenever the file was re-created)
+    }
+
+    unsigned long sessionId;
+    unsigned long timestamp;
+    unsigned long scaledValue;
+    CPRState recorded;
+    if (column < COL_REQUIRED ||
+        !parseUnsigned(fields[COL_SESSION_ID], ends[COL_SESSION_ID], sessionId) ||
+        !parseUnsigned(fields[COL_TIMESTAMP], ends[COL_TIMESTAMP], timestamp) ||
+        !parseUnsigned(fields[COL_SCALED_VALUE], ends[COL_SCALED_VALUE], scaledValue) ||
+        !parseState(fields[COL_STATE], ends[COL_STATE] - fields[COL_STATE], recorded)) {
+        stats.malformed++;
+        return false;
+    }
+
+    if (current == nullptr || current->sessionId != (int)sessionId) {
+        flushBlock();
+        finishSession();
+        startSession((int)sessionId, timestamp);
+    }
+
+    uint16_t value = (uint16_t)min(scaledValue, 1023UL);
+
+    // Fill a gap of more than one feature period (the CSV rate limit) with
+    // interpolated samples on the feature-rate grid
+    unsigned long gap = timestamp - lastRowTimestamp;
+    if (current->rows > 0 && timestamp > lastRowTimestamp &&
+        gap >= featurePeriodMs + featurePeriodMs / 2 && gap <= MAX_FILL_GAP_MS) {
+        unsigned long steps = (gap + featurePeriodMs / 2) / featurePeriodMs;
+        for (unsigned long step = 1; step < steps; step++) {
+            long delta = ((long)value - (long)lastRowValue) * (long)step;
+            long half = (delta >= 0 ? 1 : -1) * (long)(steps / 2);
+            uint16_t filled = (uint16_t)(lastRowValue + (delta + half) / (long)steps);
+            pushSample(filled, lastRowTimestamp + gap * step / steps, CPRState::Quietude, false);
+            current->interpolated++;
+            stats.interpolated++;
+        }
+    }
+
+    pushSample(value, timestamp, recorded, true);
+    current->rows++;
+    current->lastTimestamp = timestamp;
+    lastRowTimestamp = timestamp;
+    lastRowValue = value;
+    return true;
+}
+
+void SessionReplayer::pushSample(uint16_t value, unsigned long timestamp, CPRState recorded, bool isRow) {
+    blockSamples[blockCount] = value;
+    blockTimestamps[blockCount] = timestamp;
+    blockRecorded[blockCount] = recorded;
+    blockIsRow[blockCount] = isRow;
+    blockCount++;
+
+    if (blockCount == BLOCK_SIZE) {
+        flushBlock();
+    }
+}
+
+void SessionReplayer::flushBlock() {
+    if (blockCount == 0 || current == nullptr) {
+        blockCount = 0;
+        return;
+    }
+
+    CPRState replayed = calculator.getState();
+    size_t transitionCount = calculator.detectTrendBatch(blockSamples, blockTimestamps, blockCount, nullptr,
+                                                         blockTransitions, BLOCK_SIZE);
+
+    // Walk the transitions to recover the per-sample state for comparison
+    size_t next = 0;
+    for (size_t i = 0; i < blockCount; i++) {
+        while (next < transitionCount && blockTransitions[next].sampleIndex == i) {
+            replayed = blockTransitions[next++].to;
+        }
+        if (blockIsRow[i] && replayed != blockRecorded[i]) {
+            current->stateMismatches++;
+        }
+    }
+
+    current->samples += blockCount;
+    current->transitions += transitionCount;
+    stats.samples += blockCount;
+    blockCount = 0;
+}
+
+void SessionReplayer::finishSession() {
+    if (current == nullptr) {
+        return;
+    }
+
+    current->compressions = calculator.getCompressionMetrics();
+    current->recoils = calculator.getRecoilMetrics();
+    current->summary = calculator.getSessionSummary();
+    current->rate = calculator.getRate();
+    current->ccf = calculator.getCCF();
+    current->cycles = calculator.getCycles();
+    if (current->rows > 1 && current->lastTimestamp > current->firstTimestamp) {
+        current->rowRateHz = (current->rows - 1) * 1000.0f / (current->lastTimestamp - current->firstTimestamp);
+    }
+    stats.recordedMillis += current->lastTimestamp - current->firstTimestamp;
+    current = nullptr;
+}
+
+void SessionReplayer::finish() {
+    flushBlock();
+    finishSession();
+
+    stats.elapsedMicros = micros() - startMicros;
+    if (stats.elapsedMicros > 0) {
+        stats.samplesPerSecond = stats.samples * 1e6f / stats.elapsedMicros;
+        stats.speedup = stats.recordedMillis * 1000.0f / stats.elapsedMicros;
+    }
+}
+
+#ifdef ARDUINO
+bool SessionReplayer::replayFile(fs::FS& fs, const char* path) {
+    File file = fs.open(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    begin();
+    char line[160];
+    size_t sinceYield = 0;
+    while (file.available()) {
+        size_t length = file.readBytesUntil('\n', line, sizeof(line) - 1);
+        line[length] = '\0';
+        feedLine(line);
+        if (++sinceYield == YIELD_LINES) {
+            sinceYield = 0;
+            delay(1);
+        }
+    }
+    file.close();
+    finish();
+    return true;
+}
+#endif
@@ -0,0 +1,117 @@
+#ifndef SESSION_REPLAY_H
+#define SESSION_REPLAY_H
+
+#include <Arduino.h>
+#include "CPRMetricsCalculator.h"
+
+#ifdef ARDUINO
+#include <FS.h>
+#endif
+
+// Recomputed metrics for one SessionID found in a recording
+struct ReplaySessionResult {
+    int sessionId = 0;
+    size_t rows = 0;                 // Recorded rows
+    size_t samples = 0;              // Fed to the calculator, rows plus interpolated ones
+    size_t interpolated = 0;
+    float rowRateHz = 0;             // Mean recorded row rate
+    unsigned long firstTimestamp = 0;
+    unsigned long lastTimestamp = 0;
+    size_t transitions = 0;
+    size_t stateMismatches = 0;      // Rows where the recorded State differs from the replay
+    CompressionMetrics compressions;
+    RecoilMetrics recoils;
+    CPRSessionSummary summary;
+    int rate = 0;
+    float ccf = 0;
+    int cycles = 0;
+};
+
+struct ReplayStats {
+    size_t lines = 0;
+    size_t samples = 0;
+    size_t interpolated = 0;        // Samples synthesised between rows
+    size_t malformed = 0;
+    size_t sessions = 0;            // Sessions seen, including ones dropped from the result table
+    unsigned long elapsedMicros = 0;
+    unsigned long recordedMillis = 0;
+    float samplesPerSecond = 0;
+    float speedup = 0;              // Recorded time / replay time
+};
+
+// Streams rows written by writeCSVData() back through a private
+// CPRMetricsCalculator as fast as the CPU allows. Rows are buffered into
+// blocks and fed to detectTrendBatch() with their recorded timestamps, so the
+// calculator runs on the recording's clock instead of millis(). A change of
+// SessionID starts a fresh calculator run.
+//
+// The CSV holds the unfiltered ScaledValue, so replay exercises the state
+// machine, not the high-rate acquisition front end. Rows are rate-limited
+// (one per CSV_WRITE_INTERVAL, 50 ms) while the calculator runs at
+// featureRateHz, and its windows and slope margin are counted in samples.
+// So when rows are further apart than one feature period, the gap is filled
+// with samples interpolated linearly at the feature rate, and every window
+// spans the same time it does live. The filled-in values only approximate
+// what the device saw between rows: re-scored metrics are close to, not
+// identical with, the live ones. Only recorded rows count towards
+// stateMismatches.
+class SessionReplayer {
+public:
+    static constexpr size_t BLOCK_SIZE = 64;
+    static constexpr size_t MAX_SESSIONS = 16;   // Most recent sessions kept in the result table
+    static constexpr unsigned long MAX_FILL_GAP_MS = 1000;   // Longer gaps (recording stalls) are not filled
+    static constexpr size_t YIELD_LINES = 256;   // replayFile() sleeps 1 ms per this many lines so the idle task runs
+
+private:
+    CPRMetricsCalculator calculator;
+    CPRThresholds params;
+
+    uint16_t blockSamples[BLOCK_SIZE];
+    uint32_t blockTimestamps[BLOCK_SIZE];
+    CPRState blockRecorded[BLOCK_SIZE];
+    bool blockIsRow[BLOCK_SIZE];        // False for interpolated samples
+    CPRTransition blockTransitions[BLOCK_SIZE];
+    size_t blockCount;
+
+    unsigned long featurePeriodMs;
+    unsigned long lastRowTimestamp;
+    uint16_t lastRowValue;
+
+    ReplaySessionResult results[MAX_SESSIONS];
+    size_t resultCount;
+    ReplaySessionResult* current;
+    unsigned long startMicros;
+    ReplayStats stats;
+
+    void startSession(int sessionId, unsigned long timestamp);
+    void pushSample(uint16_t value, unsigned long timestamp, CPRState recorded, bool isRow);
+    void flushBlock();
+    void finishSession();
+
+public:
+    explicit SessionReplayer(const CPRThresholds& thresholds = CPRThresholds());
+
+    // Thresholds used for the next replay (e.g. the live calculator's)
+    void setParams(const CPRThresholds& thresholds);
+
+    // Start a new replay; previous results are discarded
+    void begin();
+
+    // Feed one CSV line (header lines are skipped). Returns false if malformed.
+    bool feedLine(const char* line);
+
+    // Flush the last block and finalise stats; call once after the last line
+    void finish();
+
+#ifdef ARDUINO
+    // begin() + every line of 'path' + finish(). Returns false if the file cannot be opened.
+    // Meant for a low-priority task: it runs for as long as the file takes.
+    bool replayFile(fs::FS& fs, const char* path);
+#endif
+
+    const ReplayStats& getStats() const { return stats; }
+    size_t getSessionCount() const { return resultCount; }
+    const ReplaySessionResult& getSession(size_t index) const { return results[index]; }
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef SLIDING_MEDIAN_H
+#define SLIDING_MEDIAN_H
+
+#include <stddef.h>
+#include <string.h>
+#include "RingBuffer.h"
+
+// Sliding-window median over the last N values without heap allocation.
+// Values are kept twice: in arrival order (to know what to evict) and in a
+// sorted array that is patched with a binary search and a memmove on every
+// push, so the median is always ready in O(1).
+template <typename T, size_t MaxWindow>
+class SlidingMedian {
+private:
+    RingBuffer<T, MaxWindow> arrival;
+    T sorted[MaxWindow];
+
+    // First index in sorted[0, count) whose value is not less than 'value'
+    size_t lowerBound(T value, size_t count) const {
+        size_t lo = 0;
+        size_t hi = count;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (sorted[mid] < value) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+public:
+    // Clamps to [1, MaxWindow] and clears the window
+    void setWindow(size_t window) { arrival.setCapacity(window); }
+    void clear() { arrival.clear(); }
+
+    void push(T value) {
+        size_t count = arrival.size();
+
+        if (arrival.full()) {
+            // Drop the evicted value from the sorted view first
+            size_t pos = lowerBound(arrival.oldest(), count);
+            memmove(&sorted[pos], &sorted[pos + 1], (count - pos - 1) * sizeof(T));
+            count--;
+        }
+
+        size_t pos = lowerBound(value, count);
+        memmove(&sorted[pos + 1], &sorted[pos], (count - pos) * sizeof(T));
+        sorted[pos] = value;
+
+        arrival.push(value);
+    }
+
+    size_t size() const { return arrival.size(); }
+    bool empty() const { return arrival.empty(); }
+
+    // Upper median for even-sized windows (element size() / 2 of the sorted view)
+    T median() const { return empty() ? 0 : sorted[arrival.size() / 2]; }
+};
+
+#endif
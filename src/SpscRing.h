@@ -0,0 +1,65 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Lock-free single-producer/single-consumer queue. One task (or ISR) pushes,
+// one other task pops; neither ever blocks or disables interrupts. Indices
+// are free-running and masked, so Capacity must be a power of two.
+//
+// A push into a full ring is refused (the producer cannot move the
+// consumer's index) and counted in overflows().
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+private:
+    static constexpr uint32_t MASK = Capacity - 1;
+
+    T buffer[Capacity];
+    std::atomic<uint32_t> head;          // Next slot to write (producer-owned)
+    std::atomic<uint32_t> tail;          // Next slot to read (consumer-owned)
+    std::atomic<uint32_t> overflowCount;
+
+public:
+    SpscRing() : head(0), tail(0), overflowCount(0) {}
+
+    // Producer side
+    bool push(const T& value) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == Capacity) {
+            overflowCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        buffer[h & MASK] = value;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool pop(T& value) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = buffer[t & MASK];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: drop everything currently queued
+    void discard() {
+        tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    // Either side (a snapshot; the other side may be moving)
+    size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    uint32_t overflows() const { return overflowCount.load(std::memory_order_relaxed); }
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef STAGE_MONITOR_H
+#define STAGE_MONITOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Counters for one stage of the processing pipeline: items handled, items
+// dropped because the stage's input queue was full, the latency from an
+// item being queued to the stage finishing with it, and the deepest the
+// input queue has been seen.
+//
+// record() is called by the stage's own task and recordDrop() by whichever
+// task feeds it; read() is safe from any task.
+class StageMonitor {
+public:
+    struct Snapshot {
+        uint32_t items = 0;
+        uint32_t drops = 0;
+        uint32_t latencyAvgMicros = 0;   // ~64-item moving average
+        uint32_t latencyMaxMicros = 0;
+        uint32_t queueDepth = 0;         // At the last record()
+        uint32_t queueDepthMax = 0;
+    };
+
+private:
+    static constexpr int AVERAGE_SHIFT = 6;
+
+    std::atomic<uint32_t> items;
+    std::atomic<uint32_t> drops;
+    std::atomic<uint32_t> latencyAvgScaled;   // Average << AVERAGE_SHIFT
+    std::atomic<uint32_t> latencyMax;
+    std::atomic<uint32_t> queueDepth;
+    std::atomic<uint32_t> queueDepthMax;
+
+public:
+    StageMonitor() : items(0), drops(0), latencyAvgScaled(0), latencyMax(0), queueDepth(0), queueDepthMax(0) {}
+
+    // Stage task, once per item; 'depth' is what is still waiting behind it
+    void record(uint32_t latencyMicros, size_t depth) {
+        items.fetch_add(1, std::memory_order_relaxed);
+
+        uint32_t scaled = latencyAvgScaled.load(std::memory_order_relaxed);
+        scaled = scaled - (scaled >> AVERAGE_SHIFT) + latencyMicros;
+        latencyAvgScaled.store(scaled, std::memory_order_relaxed);
+        if (latencyMicros > latencyMax.load(std::memory_order_relaxed)) {
+            latencyMax.store(latencyMicros, std::memory_order_relaxed);
+        }
+
+        queueDepth.store((uint32_t)depth, std::memory_order_relaxed);
+        if (depth > queueDepthMax.load(std::memory_order_relaxed)) {
+            queueDepthMax.store((uint32_t)depth, std::memory_order_relaxed);
+        }
+    }
+
+    // Producer side, when the stage's queue refused an item
+    void recordDrop() { drops.fetch_add(1, std::memory_order_relaxed); }
+
+    // Any task; clears the peaks only, the totals keep counting
+    void resetPeaks() {
+        latencyMax.store(0);
+        queueDepthMax.store(0);
+    }
+
+    Snapshot read() const {
+        Snapshot snapshot;
+        snapshot.items = items.load();
+        snapshot.drops = drops.load();
+        snapshot.latencyAvgMicros = latencyAvgScaled.load() >> AVERAGE_SHIFT;
+        snapshot.latencyMaxMicros = latencyMax.load();
+        snapshot.queueDepth = queueDepth.load();
+        snapshot.queueDepthMax = queueDepthMax.load();
+        return snapshot;
+    }
+};
+
+#endif
@@ -0,0 +1,246 @@
+#ifndef STREAMING_STATS_H
+#define STREAMING_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+
+// Single-quantile estimator using the P-squared algorithm (Jain & Chlamtac).
+// Five markers track the min, p/2, p, (1+p)/2 and max; each push nudges the
+// middle markers with a piecewise-parabolic fit, so memory and time per value
+// are constant no matter how long the session runs.
+class P2Quantile {
+private:
+    float p;
+    float heights[5];
+    float positions[5];
+    float desired[5];
+    float increments[5];
+    size_t count;
+
+    float parabolic(int i, float d) const {
+        float span = positions[i + 1] - positions[i - 1];
+        float upper = (positions[i] - positions[i - 1] + d) * (heights[i + 1] - heights[i]) /
+                      (positions[i + 1] - positions[i]);
+        float lower = (positions[i + 1] - positions[i] - d) * (heights[i] - heights[i - 1]) /
+                      (positions[i] - positions[i - 1]);
+        return heights[i] + d / span * (upper + lower);
+    }
+
+    float linear(int i, int d) const {
+        return heights[i] + d * (heights[i + d] - heights[i]) / (positions[i + d] - positions[i]);
+    }
+
+public:
+    explicit P2Quantile(float quantile = 0.5f) : p(quantile), count(0) {}
+
+    void clear() { count = 0; }
+
+    void push(float x) {
+        if (count < 5) {
+            // Collect the first five values in sorted order
+            size_t i = count++;
+            while (i > 0 && heights[i - 1] > x) {
+                heights[i] = heights[i - 1];
+                i--;
+            }
+            heights[i] = x;
+
+            if (count == 5) {
+                for (int m = 0; m < 5; m++) {
+                    positions[m] = m + 1;
+                }
+                desired[0] = 1;
+                desired[1] = 1 + 2 * p;
+                desired[2] = 1 + 4 * p;
+                desired[3] = 3 + 2 * p;
+                desired[4] = 5;
+                increments[0] = 0;
+                increments[1] = p / 2;
+                increments[2] = p;
+                increments[3] = (1 + p) / 2;
+                increments[4] = 1;
+            }
+            return;
+        }
+        count++;
+
+        // Find the cell holding x, widening the extremes if needed
+        int k;
+        if (x < heights[0]) {
+            heights[0] = x;
+            k = 0;
+        } else if (x >= heights[4]) {
+            heights[4] = x;
+            k = 3;
+        } else {
+            k = 0;
+            while (k < 3 && x >= heights[k + 1]) {
+                k++;
+            }
+        }
+
+        for (int m = k + 1; m < 5; m++) {
+            positions[m] += 1;
+        }
+        for (int m = 0; m < 5; m++) {
+            desired[m] += increments[m];
+        }
+
+        // Move the three middle markers towards their desired positions
+        for (int i = 1; i <= 3; i++) {
+            float d = desired[i] - positions[i];
+            if ((d >= 1 && positions[i + 1] - positions[i] > 1) ||
+                (d <= -1 && positions[i - 1] - positions[i] < -1)) {
+                int step = (d >= 0) ? 1 : -1;
+                float candidate = parabolic(i, step);
+                if (heights[i - 1] < candidate && candidate < heights[i + 1]) {
+                    heights[i] = candidate;
+                } else {
+                    heights[i] = linear(i, step);
+                }
+                positions[i] += step;
+            }
+        }
+    }
+
+    size_t size() const { return count; }
+
+    float value() const {
+        if (count == 0) {
+            return 0;
+        }
+        if (count < 5) {
+            // Nearest rank over the sorted warm-up values
+            size_t rank = (size_t)lroundf(p * (count - 1));
+            return heights[rank];
+        }
+        return heights[2];
+    }
+};
+
+// Fixed-bin histogram over [low, high). Values outside the range land in the
+// first/last bin so every push is counted; min, max and mean are exact.
+template <size_t Bins>
+class Histogram {
+    static_assert(Bins > 0, "Histogram needs at least one bin");
+
+private:
+    float low;
+    float binWidth;
+    uint32_t bins[Bins];
+    uint32_t count;
+    double sum;
+    float minValue;
+    float maxValue;
+
+public:
+    Histogram(float lowValue, float highValue) : low(lowValue), binWidth((highValue - lowValue) / Bins) {
+        clear();
+    }
+
+    void clear() {
+        for (size_t i = 0; i < Bins; i++) {
+            bins[i] = 0;
+        }
+        count = 0;
+        sum = 0;
+        minValue = 0;
+        maxValue = 0;
+    }
+
+    void push(float x) {
+        int index = (int)floorf((x - low) / binWidth);
+        if (index < 0) index = 0;
+        if (index >= (int)Bins) index = Bins - 1;
+        bins[index]++;
+
+        if (count == 0 || x < minValue) minValue = x;
+        if (count == 0 || x > maxValue) maxValue = x;
+        count++;
+        sum += x;
+    }
+
+    // Quantile by linear interpolation inside the bin that crosses rank q * count
+    float quantile(float q) const {
+        if (count == 0) {
+            return 0;
+        }
+        float target = q * count;
+        uint32_t cumulative = 0;
+        for (size_t i = 0; i < Bins; i++) {
+            if (bins[i] > 0 && cumulative + bins[i] >= target) {
+                float fraction = (target - cumulative) / bins[i];
+                float value = low + (i + fraction) * binWidth;
+                return (value < minValue) ? minValue : (value > maxValue) ? maxValue : value;
+            }
+            cumulative += bins[i];
+        }
+        return maxValue;
+    }
+
+    uint32_t operator[](size_t index) const { return bins[index]; }
+    size_t binCount() const { return Bins; }
+    float binLow(size_t index) const { return low + index * binWidth; }
+    float getBinWidth() const { return binWidth; }
+
+    uint32_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    float mean() const { return count > 0 ? (float)(sum / count) : 0; }
+    float getMin() const { return minValue; }
+    float getMax() const { return maxValue; }
+};
+
+struct DistributionSummary {
+    uint32_t count = 0;
+    float mean = 0;
+    float min = 0;
+    float max = 0;
+    float p10 = 0;
+    float p50 = 0;
+    float p90 = 0;
+};
+
+// Whole-session distribution of one metric: a coarse histogram for export and
+// P-squared estimators for the reported percentiles.
+template <size_t Bins>
+class SessionDistribution {
+private:
+    Histogram<Bins> histogram;
+    P2Quantile p10;
+    P2Quantile p50;
+    P2Quantile p90;
+
+public:
+    SessionDistribution(float low, float high) : histogram(low, high), p10(0.1f), p50(0.5f), p90(0.9f) {}
+
+    void clear() {
+        histogram.clear();
+        p10.clear();
+        p50.clear();
+        p90.clear();
+    }
+
+    void push(float x) {
+        histogram.push(x);
+        p10.push(x);
+        p50.push(x);
+        p90.push(x);
+    }
+
+    const Histogram<Bins>& getHistogram() const { return histogram; }
+
+    DistributionSummary summary() const {
+        DistributionSummary s;
+        s.count = histogram.size();
+        s.mean = histogram.mean();
+        s.min = histogram.getMin();
+        s.max = histogram.getMax();
+        s.p10 = p10.value();
+        s.p50 = p50.value();
+        s.p90 = p90.value();
+        return s;
+    }
+};
+
+#endif
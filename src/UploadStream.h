@@ -0,0 +1,82 @@
+#ifndef UPLOAD_STREAM_H
+#define UPLOAD_STREAM_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Shared between an upload in progress and whoever controls it (web
+// handlers, the status page). All fields are safe to touch from any task.
+struct UploadControl {
+    std::atomic<bool> pauseRequested;   // Stays set until resumed
+    std::atomic<bool> cancelRequested;
+    std::atomic<bool> interrupted;      // The last transfer stopped for a pause or a hold
+    std::atomic<uint32_t> bytesSent;
+    std::atomic<uint32_t> bytesTotal;
+
+    UploadControl() : pauseRequested(false), cancelRequested(false), interrupted(false), bytesSent(0), bytesTotal(0) {}
+
+    // Uploader side, before a new transfer
+    void begin(uint32_t total) {
+        cancelRequested.store(false);
+        interrupted.store(false);
+        bytesSent.store(0);
+        bytesTotal.store(total);
+    }
+};
+
+// Payload stream handed to HTTPClient::sendRequest(). It passes the source
+// through and counts the bytes taken. Once cancelled, or as soon as a pause
+// is requested or the hold check says so (a recording session in progress),
+// available() returns -1. HTTPClient then stops sending and reports a
+// payload failure.
+//
+// A pause or hold also sets control.interrupted. The caller then closes the
+// connection and queues the upload again, rather than keeping an idle socket
+// open. The upload is not resumable: the next attempt starts from byte 0.
+class UploadStream : public Stream {
+private:
+    Stream& source;
+    UploadControl& control;
+    bool (*holdCheck)();
+
+public:
+    UploadStream(Stream& payload, UploadControl& uploadControl, bool (*shouldHold)() = nullptr)
+        : source(payload), control(uploadControl), holdCheck(shouldHold) {}
+
+    // Also checked before connecting, so a held upload never opens a socket
+    bool holding() const {
+        return control.pauseRequested.load() || (holdCheck != nullptr && holdCheck());
+    }
+
+    int available() override {
+        if (control.cancelRequested.load()) {
+            return -1;
+        }
+        if (holding()) {
+            control.interrupted.store(true);
+            return -1;
+        }
+        return source.available();
+    }
+
+    int read() override {
+        int value = source.read();
+        if (value >= 0) {
+            control.bytesSent.fetch_add(1);
+        }
+        return value;
+    }
+
+    size_t readBytes(char* buffer, size_t length) override {
+        size_t count = source.readBytes(buffer, length);
+        control.bytesSent.fetch_add(count);
+        return count;
+    }
+
+    int peek() override { return source.peek(); }
+
+    // Read-only
+    size_t write(uint8_t) override { return 0; }
+};
+
+#endif
@@ -7,11 +7,20 @@
 #include <Preferences.h>
 #include <WiFiClientSecure.h>
 #include <HTTPClient.h>
+#include <StreamString.h>
 #include <base64.h>
 #include <time.h>
 #include "CPRMetricsCalculator.h"
 #include "DatabaseManager.h"
 #include "NetworkManager.h"
+#include "SessionReplay.h"
+#include "SeqLock.h"
+#include "AdcSampler.h"
+#include "AdcCalibration.h"
+#include "StageMonitor.h"
+#include "UploadStream.h"
+#include <atomic>
+#include <esp_timer.h>
 #include <mbedtls/md.h>
 #include <mbedtls/sha256.h>
 #include "esp_wifi.h"
@@ -29,9 +38,10 @@
 void onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
 void onAnimWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
 void broadcastStateUpdate(const CPRStatus& status);
+void broadcastCompressionEvent(const CPRCompressionEvent& event);
 void broadcastAnimationState(const String& state);
-void updateStatusLED(const String& state);
-void processAudioAlerts(const std::vector<String>& alerts);
+void updateStatusLED(CPRState state);
+void processAudioAlerts(const CPRAlerts& alerts);
 void checkSPIFFSHealth();
 bool initializeSPIFFSWithRetry();
 void checkRequiredFiles();
@@ -47,7 +57,7 @@ void closeCSVFile();
 String chipId = "";              // Unique ESP32 chip ID
 String csvFileName = "";         // Dynamic filename based on chip ID
 bool fileUploadInProgress = false;
-bool spiffsDangerMode = false;
+std::atomic<bool> spiffsDangerMode(false);  // Written by the persistence task
 const float SPIFFS_DANGER_THRESHOLD = 85.0; // 85% usage triggers danger mode
 const float SPIFFS_SAFE_THRESHOLD = 75.0;   // 75% usage exits danger mode (hysteresis)
 unsigned long lastDangerBlink = 0;
@@ -69,12 +79,56 @@ struct CloudConfig {
     int syncedSessions;
 };
 
-// Global cloud configuration
+// Global cloud configuration. The web handlers write the Strings on the
+// AsyncTCP task; the cloud sync task copies them under cloudConfigMutex.
 CloudConfig cloudConfig;
+SemaphoreHandle_t cloudConfigMutex = nullptr;
 Preferences cloudPrefs;
-bool cloudSyncInProgress = false;
 unsigned long lastCloudSyncAttempt = 0;
 const unsigned long CLOUD_SYNC_RETRY_INTERVAL = 300000; // 5 minutes retry
+
+// Cloud sync runs on its own low-priority task; loop() and the web handlers
+// only request, pause or cancel it and read its progress
+enum class CloudSyncOutcome : uint8_t {
+    None = 0,
+    Success,
+    Skipped,        // Nothing to upload
+    Deferred,       // A recording session holds the CSV file
+    Failed,
+    Cancelled,
+    Interrupted     // Paused or a recording started; queued again
+};
+
+std::atomic<bool> cloudSyncInProgress(false);
+std::atomic<bool> cloudSyncRequested(false);        // Manual trigger, skips the schedule
+std::atomic<uint8_t> cloudSyncLastOutcome(0);       // CloudSyncOutcome
+UploadControl cloudUpload;
+TaskHandle_t cloudSyncTaskHandle = nullptr;
+SemaphoreHandle_t csvRotated = nullptr;             // Given by the persistence task
+const char* CLOUD_PENDING_FILE = "/cloud_pending.csv";   // CSV data moved aside for upload
+const TickType_t CLOUD_SYNC_POLL = pdMS_TO_TICKS(5000);
+const int CLOUD_SYNC_TASK_CORE = 0;
+const UBaseType_t CLOUD_SYNC_TASK_PRIORITY = 1;     // Below persistence; TLS work never delays it
+const uint32_t CLOUD_SYNC_TASK_STACK = 8192;
+
+// /test_cloud_connection hands the credentials under test to the sync task
+// and reports the result through /cloud_sync_status
+enum class CloudTestState : uint8_t {
+    Idle = 0,
+    Claimed,        // A handler is filling in cloudTestConfig
+    Queued,
+    Running
+};
+
+enum class CloudTestResult : uint8_t {
+    None = 0,
+    Success,
+    Failed
+};
+
+std::atomic<uint8_t> cloudTestState(0);             // CloudTestState
+std::atomic<uint8_t> cloudTestResult(0);            // CloudTestResult
+CloudConfig cloudTestConfig;                        // Owned by whoever moved the state last
 // =============================================
 // WIFI CONFIGURATION MANAGER CLASS
 // =============================================
@@ -83,10 +137,9 @@ private:
     AsyncWebServer* server;
     String apSSID;
     String apPassword;
-    bool wifiConnected = false;
+    std::atomic<bool> wifiConnected{false};    // Read by web handlers and the cloud sync task
     bool hotspotActive = false;
     unsigned long lastConnectionAttempt = 0;
-    unsigned long connectionCheckInterval = 30000;
     Preferences preferences;
     
 public:
@@ -124,14 +177,9 @@ public:
         Serial.println("🌐 Configuration URL: http://192.168.4.1/ssid_config");
     }
     
+    // Connection state comes from NetworkManager's events; this only mirrors it
     void loop() {
-        static unsigned long lastCheck = 0;
-        unsigned long now = millis();
-        
-        if (now - lastCheck > connectionCheckInterval) {
-            lastCheck = now;
-            checkWiFiStatus();
-        }
+        checkWiFiStatus();
     }
     
     void startHotspot() {
@@ -166,15 +214,27 @@ public:
         Serial.println("🔄 Connecting to WiFi: " + ssid);
         lastConnectionAttempt = millis();
         
+        // Keep the hotspot up; NetworkManager runs the attempt and any retries
         WiFi.mode(WIFI_AP_STA);
-        WiFi.begin(ssid.c_str(), password.c_str());
+        extern NetworkManager* networkManager;
+        networkManager->connectToWiFi(ssid, password);
         
         Serial.println("⏳ WiFi connection initiated...");
     }
     
+    // Loop context (loop() and NetworkManager's state callback)
     void checkWiFiStatus() {
+        extern NetworkManager* networkManager;
         bool wasConnected = wifiConnected;
-        wifiConnected = (WiFi.status() == WL_CONNECTED);
+        wifiConnected = networkManager->isWiFiConnected();
+        
+        // New credentials are stored only once a connection with them succeeded
+        WiFiConfig confirmed;
+        if (networkManager->takeConfirmedCredentials(confirmed)) {
+            preferences.putString("ssid", confirmed.ssid);
+            preferences.putString("password", confirmed.password);
+            Serial.printf("WiFi credentials saved: %s\n", confirmed.ssid.c_str());
+        }
         
         if (wifiConnected != wasConnected) {
             if (wifiConnected) {
@@ -182,20 +242,8 @@ public:
                 Serial.println("📶 SSID: " + WiFi.SSID());
                 Serial.println("📡 Signal: " + String(WiFi.RSSI()) + " dBm");
                 Serial.println("🌐 IP: " + WiFi.localIP().toString());
-                extern NetworkManager* networkManager;
-                if (networkManager) {
-                    networkManager->handleTasks();
-                }
             } else {
-                Serial.println("❌ WiFi Disconnected");
-                
-                // Try to reconnect with saved credentials
-                String savedSSID = preferences.getString("ssid", "");
-                String savedPassword = preferences.getString("password", "");
-                if (savedSSID.length() > 0) {
-                    Serial.println("🔄 Attempting to reconnect...");
-                    WiFi.begin(savedSSID.c_str(), savedPassword.c_str());
-                }
+                Serial.println("❌ WiFi Disconnected - reconnecting");
             }
         }
     }
@@ -206,16 +254,12 @@ public:
             return false;
         }
         
-        // Save to preferences
-        preferences.putString("ssid", ssid);
-        preferences.putString("password", password);
-        
-        Serial.printf("WiFi credentials saved: %s\n", ssid.c_str());
-        
-        // Attempt connection
-        connectToWiFi(ssid, password);
-        
-        return true;
+        // NetworkManager tests them; checkWiFiStatus() stores them once they
+        // connect, and a failure goes back to the current network
+        Serial.println("🔄 Testing WiFi credentials: " + ssid);
+        lastConnectionAttempt = millis();
+        extern NetworkManager* networkManager;
+        return networkManager->saveWiFiCredentials(ssid, password);
     }
     
     bool isWiFiConnected() const { return wifiConnected; }
@@ -238,7 +282,8 @@ public:
     void resetConfig() {
         preferences.remove("ssid");
         preferences.remove("password");
-        WiFi.disconnect();
+        extern NetworkManager* networkManager;
+        networkManager->disconnectWiFi();
         Serial.println("🗑️ WiFi configuration reset");
     }
 };
@@ -251,29 +296,216 @@ AsyncWebServer server(80);
 AsyncWebSocket webSocket("/ws");          // Metrics WebSocket (2Hz)
 AsyncWebSocket animWebSocket("/animws");  // Animation WebSocket (20Hz)
 
-// Global State
-bool isRecording = false;
+// Global State (recording flags are owned by the metrics task)
+std::atomic<bool> isRecording(false);
 int currentSessionId = 0;
-unsigned long lastPotRead = 0;
+unsigned long lastPotReadMicros = 0;
 unsigned long lastDataSend = 0;
 unsigned long lastAnimSend = 0;
 unsigned long lastStateChange = 0;
 String lastBroadcastState = "";
 String lastAnimState = "";
 
-// Enhanced CSV Data Logging with Chip ID
+// Enhanced CSV Data Logging with Chip ID (file owned by the persistence task)
 File csvFile;
-bool csvFileOpen = false;
+std::atomic<bool> csvFileOpen(false);
+int csvSessionId = 0;                          // Session the open file belongs to
 unsigned long lastCSVWrite = 0;
+unsigned long lastCSVQueued = 0;               // Metrics task side of the rate limit
 const unsigned long CSV_WRITE_INTERVAL = 50; // 50ms for frequent writes
-int csvWriteCount = 0;
+std::atomic<int> csvWriteCount(0);
 
 // Session number tracking
 Preferences sessionPrefs;
 int lastSessionNumber = 0;
 
-// Optimized timing intervals
-const unsigned long POT_READ_INTERVAL = 25;     // 40Hz sampling
+// Continuous acquisition on core 1; the metrics task drains its ring. Timer
+// mode is the fallback if the DMA driver cannot be started.
+AdcSampler adcSampler;
+const AcquisitionMode PREFERRED_ACQUISITION_MODE = AcquisitionMode::Dma;
+
+// ADC code -> calculator units lookup (eFuse-characterised when available)
+AdcCalibration adcCalibration;
+
+const char* acquisitionModeName() {
+    if (!adcSampler.isRunning()) return "polled";
+    return adcSampler.getMode() == AcquisitionMode::Dma ? "dma" : "timer";
+}
+
+// Calculator cost per ADC sample (CPU cycles), to keep high-rate mode in check
+uint32_t sampleCyclesAvg = 0;
+uint32_t sampleCyclesMax = 0;
+
+// Offline re-scoring of recorded CSV sessions on its own low-priority task.
+// The task holds replayResultsMutex for a whole replay; /replay_status only
+// try-takes it, so it never waits and never reads results mid-replay.
+SessionReplayer* sessionReplayer = nullptr;
+std::atomic<bool> replayBusy(false);            // Claimed by /replay_session, released by the task
+std::atomic<bool> replayHasResults(false);      // Set once the results are final
+SemaphoreHandle_t replayResultsMutex = nullptr;
+TaskHandle_t replayTaskHandle = nullptr;
+String replayFileName = "";                     // Written only by the handler that claims replayBusy
+const int REPLAY_TASK_CORE = 0;
+const UBaseType_t REPLAY_TASK_PRIORITY = 1;     // Below persistence, next to cloud sync
+const uint32_t REPLAY_TASK_STACK = 8192;
+
+// The metrics task owns metricsCalculator and the recording flags. Web
+// handlers run on the AsyncTCP task, so they read the snapshot the metrics
+// task publishes and queue commands to it instead of touching that state.
+struct PublishedState {
+    CPRStatus status;                 // status.thresholds is the active config
+    CPRSessionSummary summary;
+    bool isRecording = false;
+    bool csvFileOpen = false;
+    bool spiffsDangerMode = false;
+    int currentSessionId = 0;
+    int lastSessionNumber = 0;
+    int csvWriteCount = 0;
+    unsigned long sampleIntervalMicros = 0;
+    int decimationFactor = 1;
+    uint32_t sampleCyclesAvg = 0;
+    uint32_t sampleCyclesMax = 0;
+    uint32_t lastCommandId = 0;       // Last command the metrics task has applied
+};
+
+enum class ControlCommandType : uint8_t {
+    ToggleRecording,
+    StopRecording,
+    UpdateParams
+};
+
+struct ControlCommand {
+    ControlCommandType type;
+    uint32_t id;
+    CPRThresholds params;             // UpdateParams only
+};
+
+SeqLock<PublishedState> publishedState;
+QueueHandle_t controlQueue = nullptr;
+std::atomic<uint32_t> nextCommandId(1);
+uint32_t lastAppliedCommandId = 0;
+unsigned long lastStatusPublish = 0;
+const int CONTROL_QUEUE_LENGTH = 4;
+const unsigned long STATUS_PUBLISH_INTERVAL = 100;  // 10Hz, plus right after every command
+
+uint32_t queueControlCommand(ControlCommand& command);
+
+// =============================================
+// PROCESSING PIPELINE
+// =============================================
+// acquisition task (core 1) -> SPSC ring -> metrics task (core 1)
+//   -> persistQueue -> persistence task (core 0): CSV rows, DB events, SPIFFS health
+//   -> uiQueue -> loop() (core 1, lowest priority): WebSockets, LED, audio, network
+// Every queue is bounded. A full queue drops the item and counts it, so a
+// stalled consumer never blocks the stages in front of it.
+
+// One CSV row, built by the metrics task from its snapshot
+struct CsvRow {
+    unsigned long timestamp = 0;
+    int rawValue = 0;
+    int scaledValue = 0;
+    CPRState state = CPRState::Quietude;
+    bool isGood = false;
+    float compressionPeak = 0;
+    float recoilMin = 0;
+    int rate = 0;
+    float ccf = 0;
+};
+
+enum class PersistRecordType : uint8_t {
+    SessionStart,
+    SessionEnd,
+    Sample,
+    Compression,
+    RotateForUpload,    // From the cloud sync task
+    DeleteCsv           // From /delete_csv
+};
+
+// Result of the last DeleteCsv record, reported in /status
+enum class CsvDeleteOutcome : uint8_t {
+    None = 0,
+    Deleted,
+    Missing,
+    InUse,          // A session had opened the file by the time it ran
+    Failed
+};
+
+std::atomic<uint8_t> csvDeleteLastOutcome(0);       // CsvDeleteOutcome
+
+struct PersistRecord {
+    PersistRecordType type;
+    uint32_t queuedMicros;
+    int sessionId;
+    CsvRow row;                       // Sample
+    CPRCompressionEvent compression;  // Compression
+    CPRSessionSummary summary;        // SessionEnd
+};
+
+enum class UiEventType : uint8_t {
+    StateUpdate,
+    Compression,
+    RecordingChanged,
+    CommandApplied
+};
+
+struct UiEvent {
+    UiEventType type;
+    uint32_t queuedMicros;
+    CPRState state;                   // StateUpdate
+    CPRAlerts alerts;                 // StateUpdate
+    bool recording;                   // StateUpdate, RecordingChanged
+    int sessionId;                    // RecordingChanged, CommandApplied
+    uint32_t commandId;               // CommandApplied
+    ControlCommandType command;       // CommandApplied
+    CPRCompressionEvent compression;  // Compression
+};
+
+QueueHandle_t persistQueue = nullptr;
+QueueHandle_t uiQueue = nullptr;
+StageMonitor metricsStage;
+StageMonitor persistStage;
+StageMonitor uiStage;
+
+// Metrics task side of the UI stream
+CPRState lastQueuedUiState = CPRState::Quietude;
+unsigned long lastAlertQueued = 0;
+
+// loop() side of the UI stream
+CPRState uiState = CPRState::Quietude;
+
+const int PERSIST_QUEUE_LENGTH = 48;                        // ~2 s of CSV rows plus events
+const int UI_QUEUE_LENGTH = 32;
+const TickType_t SESSION_RECORD_WAIT = pdMS_TO_TICKS(50);   // Session markers may wait; rows never do
+const int METRICS_TASK_CORE = 1;                            // Next to acquisition
+const UBaseType_t METRICS_TASK_PRIORITY = 5;                // Below acquisition (10), above loop() (1)
+const uint32_t METRICS_TASK_STACK = 8192;
+const TickType_t METRICS_TASK_PERIOD = pdMS_TO_TICKS(5);    // Ring drain interval
+const int PERSIST_TASK_CORE = 0;
+const UBaseType_t PERSIST_TASK_PRIORITY = 2;
+const uint32_t PERSIST_TASK_STACK = 8192;
+const TickType_t PERSIST_IDLE_WAIT = pdMS_TO_TICKS(1000);   // SPIFFS health check cadence when idle
+
+// Producer side; a full queue drops the record and counts it against the stage
+bool queuePersistRecord(PersistRecord& record, TickType_t wait) {
+    record.queuedMicros = micros();
+    if (persistQueue == nullptr || xQueueSend(persistQueue, &record, wait) != pdTRUE) {
+        persistStage.recordDrop();
+        return false;
+    }
+    return true;
+}
+
+bool queueUiEvent(UiEvent& event) {
+    event.queuedMicros = micros();
+    if (uiQueue == nullptr || xQueueSend(uiQueue, &event, 0) != pdTRUE) {
+        uiStage.recordDrop();
+        return false;
+    }
+    return true;
+}
+
+// Optimized timing intervals (ADC sampling interval comes from the calculator,
+// 25ms / 40Hz by default, down to 1ms in high-rate mode)
 const unsigned long DATA_SEND_INTERVAL = 500;   // 2Hz metrics updates
 const unsigned long ANIM_SEND_INTERVAL = 50;    // 20Hz animation updates
 const unsigned long STATE_CHANGE_DEBOUNCE = 50;
@@ -290,6 +522,7 @@ bool isCurrentlyPlayingAudio = false;
 // CLOUD UTILITY FUNCTIONS
 // =============================================
 void initializeCloudConfig() {
+    cloudConfigMutex = xSemaphoreCreateMutex();
     cloudPrefs.begin("cloud", false);
     
     cloudConfig.provider = cloudPrefs.getString("provider", "");
@@ -309,7 +542,16 @@ void initializeCloudConfig() {
     Serial.printf("  Last Sync: %lu\n", cloudConfig.lastSyncTime);
 }
 
+// Consistent copy of the configuration for the cloud sync task
+CloudConfig readCloudConfig() {
+    xSemaphoreTake(cloudConfigMutex, portMAX_DELAY);
+    CloudConfig config = cloudConfig;
+    xSemaphoreGive(cloudConfigMutex);
+    return config;
+}
+
 void saveCloudConfig() {
+    xSemaphoreTake(cloudConfigMutex, portMAX_DELAY);
     cloudPrefs.putString("provider", cloudConfig.provider);
     cloudPrefs.putString("accessKey", cloudConfig.accessKey);
     cloudPrefs.putString("secretKey", cloudConfig.secretKey);
@@ -319,6 +561,7 @@ void saveCloudConfig() {
     cloudPrefs.putBool("enabled", cloudConfig.enabled);
     cloudPrefs.putULong("lastSync", cloudConfig.lastSyncTime);
     cloudPrefs.putInt("syncedSessions", cloudConfig.syncedSessions);
+    xSemaphoreGive(cloudConfigMutex);
     
     Serial.println("Cloud configuration saved");
 }
@@ -521,48 +764,27 @@ String generateAWSv4Signature(const String& method, const String& uri, const Str
 }
 
 
-// Replace your existing uploadToCloud function with this corrected version
-// Updated uploadToCloud function with proper AWS Signature v4
-bool uploadToCloud(const String& fileName, const String& localFilePath) {
-    if (!cloudConfig.enabled || cloudConfig.provider.isEmpty()) {
-        Serial.println("☁️ Cloud upload disabled or not configured");
-        return false;
-    }
-
-    if (!wifiConfigManager->isWiFiConnected()) {
-        Serial.println("📡 WiFi not connected - cannot upload to cloud");
-        return false;
-    }
-
-    File f = SPIFFS.open(localFilePath, "r");
-    if (!f) {
-        Serial.printf("❌ Failed to open file for upload: %s\n", localFilePath.c_str());
-        return false;
-    }
-
-    size_t fileSize = f.size();
-    Serial.printf("📤 Preparing to upload %s (%u bytes) to cloud...\n",
-                  localFilePath.c_str(), fileSize);
-
+// Cloud sync task only: PUTs 'size' bytes of 'payload' as 'fileName' with
+// the credentials in 'config'. Returns the HTTP status (negative on error).
+int putToCloud(const CloudConfig& config, const String& fileName, Stream& payload, size_t size) {
     WiFiClientSecure client;
     client.setInsecure();       // skip cert validation, saves RAM
     client.setTimeout(30000);
 
     HTTPClient http;
     // host = drishcpr.sfo3.digitaloceanspaces.com
-    String host = cloudConfig.bucketName + "." + cloudConfig.endpointUrl;
+    String host = config.bucketName + "." + config.endpointUrl;
     String uri = "/" + fileName;
     String uploadUrl = "https://" + host + uri;
 
     if (!http.begin(client, uploadUrl)) {
         Serial.println("❌ Failed to begin HTTP connection");
-        f.close();
-        return false;
+        return HTTPC_ERROR_CONNECTION_REFUSED;
     }
 
     // === AWS v4 signature with UNSIGNED-PAYLOAD ===
     String authHeader = generateAWSv4Signature("PUT", uri, host, "text/csv", "",
-                                               cloudConfig.accessKey, cloudConfig.secretKey,
+                                               config.accessKey, config.secretKey,
                                                true /* unsignedPayload */);
 
     String datetime = getAWSDateTime();
@@ -572,26 +794,63 @@ bool uploadToCloud(const String& fileName, const String& localFilePath) {
     http.addHeader("x-amz-content-sha256", "UNSIGNED-PAYLOAD");
     http.addHeader("Host", host);
     http.addHeader("Content-Type", "text/csv");
-    http.addHeader("Content-Length", String(fileSize));
+    http.addHeader("Content-Length", String(size));
 
     Serial.println("🚀 Starting upload (streaming)...");
     Serial.printf("Free heap before PUT: %u bytes\n", ESP.getFreeHeap());
 
-    int httpResponseCode = http.sendRequest("PUT", &f, fileSize);
-    f.close();
-
+    int httpResponseCode = http.sendRequest("PUT", &payload, size);
     Serial.printf("HTTP Response Code: %d\n", httpResponseCode);
+    http.end();
 
-    bool uploadResult = (httpResponseCode == 200 || httpResponseCode == 201);
+    return httpResponseCode;
+}
 
-    http.end();
+// Cloud sync task only: uploads a SPIFFS file and deletes it once stored
+bool uploadToCloud(const CloudConfig& config, const String& fileName, const String& localFilePath) {
+    if (!config.enabled || config.provider.isEmpty()) {
+        Serial.println("☁️ Cloud upload disabled or not configured");
+        return false;
+    }
+
+    if (!wifiConfigManager->isWiFiConnected()) {
+        Serial.println("📡 WiFi not connected - cannot upload to cloud");
+        return false;
+    }
+
+    File f = SPIFFS.open(localFilePath, "r");
+    if (!f) {
+        Serial.printf("❌ Failed to open file for upload: %s\n", localFilePath.c_str());
+        return false;
+    }
+
+    size_t fileSize = f.size();
+    
+    // Stopped while paused or while a session is recording, aborted on cancel
+    cloudUpload.begin(fileSize);
+    UploadStream payload(f, cloudUpload, []() -> bool { return isRecording.load(); });
+    if (payload.holding()) {
+        Serial.println("⏸️ Upload paused or recording in progress - not connecting");
+        cloudUpload.interrupted = true;
+        f.close();
+        return false;
+    }
+    
+    Serial.printf("📤 Preparing to upload %s (%u bytes) to cloud...\n",
+                  localFilePath.c_str(), fileSize);
+
+    int httpResponseCode = putToCloud(config, fileName, payload, fileSize);
+    f.close();
+
+    bool uploadResult = (httpResponseCode == 200 || httpResponseCode == 201);
 
     if (uploadResult) {
         Serial.printf("✅ Upload successful, deleting local file: %s\n", localFilePath.c_str());
         if (SPIFFS.remove(localFilePath)) {
             Serial.println("🗑️ Local file deleted");
         }
-        initializeCSVFile(); // re-init CSV after successful upload
+    } else if (cloudUpload.interrupted) {
+        Serial.println("⏸️ Upload interrupted - keeping local file");
     } else {
         Serial.println("❌ Upload failed - keeping local file");
     }
@@ -602,60 +861,159 @@ bool uploadToCloud(const String& fileName, const String& localFilePath) {
 }
 
 
-bool testCloudConnection() {
-    if (cloudConfig.provider.isEmpty() || cloudConfig.accessKey.isEmpty()) {
+// Cloud sync task only: PUTs a small in-memory object with the credentials
+// under test
+bool testCloudConnection(const CloudConfig& config) {
+    if (config.provider.isEmpty() || config.accessKey.isEmpty()) {
         return false;
     }
     
-    // Test with a small dummy file
-    String testContent = "test," + String(millis()) + "\n";
+    StreamString testContent;
+    testContent.print("test," + String(millis()) + "\n");
     String testFileName = chipId + "_test_" + String(millis()) + ".csv";
     
-    return uploadToCloud(testFileName, testContent);
+    int httpResponseCode = putToCloud(config, testFileName, testContent, testContent.length());
+    return httpResponseCode == 200 || httpResponseCode == 201;
 }
 
-void performCloudSync() {
-    if (cloudSyncInProgress || !cloudConfig.enabled) {
-        return;
+// Cloud sync task: runs a test queued by /test_cloud_connection
+void runCloudTest() {
+    cloudTestState = (uint8_t)CloudTestState::Running;
+    Serial.printf("☁️ Testing cloud connection to %s\n", cloudTestConfig.bucketName.c_str());
+    
+    bool passed = wifiConfigManager->isWiFiConnected() && testCloudConnection(cloudTestConfig);
+    Serial.printf("☁️ Cloud connection test %s\n", passed ? "passed" : "failed");
+    
+    cloudTestResult = (uint8_t)(passed ? CloudTestResult::Success : CloudTestResult::Failed);
+    cloudTestState = (uint8_t)CloudTestState::Idle;
+}
+
+// Cloud sync task: asks the persistence task, which owns the CSV file, to
+// move it aside for upload and start a fresh one. Fails if a recording
+// session has opened the file in the meantime.
+bool rotateCsvForUpload() {
+    xSemaphoreTake(csvRotated, 0);   // Clear a stale give
+    
+    PersistRecord record;
+    record.type = PersistRecordType::RotateForUpload;
+    if (!queuePersistRecord(record, SESSION_RECORD_WAIT)) {
+        return false;
+    }
+    if (xSemaphoreTake(csvRotated, pdMS_TO_TICKS(5000)) != pdTRUE) {
+        return false;
     }
+    return SPIFFS.exists(CLOUD_PENDING_FILE);
+}
 
+// Cloud sync task: is an upload due? Never while a session is recording or
+// while sync is paused
+bool cloudSyncDue() {
+    if (!cloudConfig.enabled || isRecording || csvFileOpen || cloudUpload.pauseRequested ||
+        !wifiConfigManager->isWiFiConnected()) {
+        return false;
+    }
+    if (cloudSyncRequested) {
+        return true;
+    }
+    
     unsigned long now = millis();
     unsigned long syncInterval = cloudConfig.syncFrequency * 60000UL;
+    if (now - cloudConfig.lastSyncTime < syncInterval) return false;
+    if (now - lastCloudSyncAttempt < CLOUD_SYNC_RETRY_INTERVAL) return false;
+    return true;
+}
 
-    if (now - cloudConfig.lastSyncTime < syncInterval) return;
-    if (now - lastCloudSyncAttempt < CLOUD_SYNC_RETRY_INTERVAL) return;
-
+// Cloud sync task only
+void performCloudSync() {
+    unsigned long now = millis();
     lastCloudSyncAttempt = now;
+    cloudSyncRequested = false;
     cloudSyncInProgress = true;
-
+    cloudUpload.begin(0);
+    
     Serial.println("Starting cloud sync...");
-
-    if (SPIFFS.exists(csvFileName)) {
-        if (isCSVFileEmpty()) {
-            Serial.println("📄 CSV file is empty - skipping upload");
+    CloudSyncOutcome outcome;
+    CloudConfig config = readCloudConfig();
+    
+    // Data left by an interrupted upload goes first; otherwise the live CSV
+    // file is moved aside so a new session can record while it uploads
+    if (!SPIFFS.exists(CLOUD_PENDING_FILE) && (!SPIFFS.exists(csvFileName) || isCSVFileEmpty())) {
+        Serial.println("📄 No CSV data - skipping upload");
+        cloudConfig.lastSyncTime = now;
+        saveCloudConfig();
+        outcome = CloudSyncOutcome::Skipped;
+    } else if (!SPIFFS.exists(CLOUD_PENDING_FILE) && !rotateCsvForUpload()) {
+        Serial.println("⏸️ CSV file in use by a recording - cloud sync deferred");
+        outcome = CloudSyncOutcome::Deferred;
+    } else {
+        String cloudFileName = chipId + "_" + String(cloudConfig.syncedSessions + 1) + ".csv";
+        if (uploadToCloud(config, cloudFileName, CLOUD_PENDING_FILE)) {
             cloudConfig.lastSyncTime = now;
+            cloudConfig.syncedSessions++;
             saveCloudConfig();
+            Serial.println("☁️ Cloud sync completed successfully");
+            outcome = CloudSyncOutcome::Success;
+        } else if (cloudUpload.cancelRequested) {
+            Serial.println("⏹️ Cloud sync cancelled - data kept for the next sync");
+            outcome = CloudSyncOutcome::Cancelled;
+        } else if (cloudUpload.interrupted) {
+            // Runs again as soon as the pause or the recording ends
+            Serial.println("⏸️ Cloud sync interrupted - queued to run again");
+            cloudSyncRequested = true;
+            outcome = CloudSyncOutcome::Interrupted;
         } else {
-            String cloudFileName = chipId + "_" + String(cloudConfig.syncedSessions + 1) + ".csv";
-            // 🔑 Call new streaming upload
-            if (uploadToCloud(cloudFileName, csvFileName)) {
-                cloudConfig.lastSyncTime = now;
-                cloudConfig.syncedSessions++;
-                saveCloudConfig();
-                Serial.println("☁️ Cloud sync completed successfully");
-            } else {
-                Serial.println("❌ Cloud sync failed");
-            }
+            Serial.println("❌ Cloud sync failed");
+            outcome = CloudSyncOutcome::Failed;
         }
-    } else {
-        Serial.println("📄 No CSV file found - skipping upload");
-        cloudConfig.lastSyncTime = now;
-        saveCloudConfig();
     }
-
+    
+    cloudSyncLastOutcome = (uint8_t)outcome;
     cloudSyncInProgress = false;
 }
 
+// Uploads and connection tests run here, never on loop() or a web handler,
+// so a slow endpoint cannot hold up metrics or the WebSocket feed
+void cloudSyncTask(void* arg) {
+    for (;;) {
+        // Woken early by /trigger_cloud_sync
+        ulTaskNotifyTake(pdTRUE, CLOUD_SYNC_POLL);
+        if (cloudTestState == (uint8_t)CloudTestState::Queued) {
+            runCloudTest();
+        }
+        if (cloudSyncDue()) {
+            performCloudSync();
+        }
+    }
+}
+
+void startCloudSyncWorker() {
+    csvRotated = xSemaphoreCreateBinary();
+    if (xTaskCreatePinnedToCore(cloudSyncTask, "cloud_sync", CLOUD_SYNC_TASK_STACK, nullptr,
+                                CLOUD_SYNC_TASK_PRIORITY, &cloudSyncTaskHandle, CLOUD_SYNC_TASK_CORE) != pdPASS) {
+        Serial.println("❌ Failed to start the cloud sync task");
+    }
+}
+
+const char* cloudTestResultName(CloudTestResult result) {
+    switch (result) {
+        case CloudTestResult::Success: return "success";
+        case CloudTestResult::Failed: return "failed";
+        default: return "none";
+    }
+}
+
+const char* cloudSyncOutcomeName(CloudSyncOutcome outcome) {
+    switch (outcome) {
+        case CloudSyncOutcome::Success: return "success";
+        case CloudSyncOutcome::Skipped: return "skipped";
+        case CloudSyncOutcome::Deferred: return "deferred";
+        case CloudSyncOutcome::Failed: return "failed";
+        case CloudSyncOutcome::Cancelled: return "cancelled";
+        case CloudSyncOutcome::Interrupted: return "interrupted";
+        default: return "none";
+    }
+}
+
 
 // =============================================
 // WEBSOCKET FUNCTIONS
@@ -700,7 +1058,7 @@ void broadcastStateUpdate(const CPRStatus& status) {
     JsonDocument doc;
     doc["type"] = "metrics";
     doc["timestamp"] = status.timestamp;
-    doc["state"] = status.state;
+    doc["state"] = cprStateToString(status.state);
     doc["rate"] = status.currentRate;
     doc["value"] = status.rawValue;
     doc["peak"] = status.peakValue;
@@ -715,10 +1073,15 @@ void broadcastStateUpdate(const CPRStatus& status) {
     doc["ccf"] = status.ccf;
     doc["cycles"] = status.cycles;
     
-    // Add alerts
+    // Add alerts, rendering text only for the codes that are set
     JsonArray alerts = doc["alerts"].to<JsonArray>();
-    for (const String& alert : status.alerts) {
-        alerts.add(alert);
+    char alertText[64];
+    for (uint8_t i = 0; i < static_cast<uint8_t>(CPRAlertCode::Count); i++) {
+        CPRAlertCode code = static_cast<CPRAlertCode>(i);
+        if (status.alerts.has(code)) {
+            formatAlert(code, status.alerts, alertText, sizeof(alertText));
+            alerts.add((char*)alertText); // non-const so ArduinoJson copies it
+        }
     }
     
     String message;
@@ -726,6 +1089,28 @@ void broadcastStateUpdate(const CPRStatus& status) {
     webSocket.textAll(message);
 }
 
+// One message per completed compression cycle (~2Hz while compressing)
+void broadcastCompressionEvent(const CPRCompressionEvent& event) {
+    if (webSocket.count() == 0) return;
+    
+    JsonDocument doc;
+    doc["type"] = "compression";
+    doc["onset"] = event.onsetTime;
+    doc["interval"] = event.interval;
+    doc["duration"] = event.duration;
+    doc["depth"] = event.peakDepth;
+    doc["recoil"] = event.recoilMin;
+    doc["flags"] = event.flags;
+    doc["is_good"] = event.isGood();
+    doc["depth_ok"] = event.has(CPRCompressionFlag::DepthOk);
+    doc["recoil_ok"] = event.has(CPRCompressionFlag::RecoilOk);
+    doc["rate_ok"] = event.has(CPRCompressionFlag::RateOk);
+    
+    String message;
+    serializeJson(doc, message);
+    webSocket.textAll(message);
+}
+
 void broadcastAnimationState(const String& state) {
     if (animWebSocket.count() == 0) return;
     
@@ -747,12 +1132,13 @@ void broadcastNetworkStatus() {
     JsonDocument doc;
     doc["type"] = "network_status";
     doc["wifi_connected"] = wifiConfigManager->isWiFiConnected();
+    doc["wifi_state"] = NetworkManager::getWiFiStateName(networkManager->getWiFiState());
     doc["wifi_ssid"] = wifiConfigManager->getSSID();
     doc["wifi_rssi"] = wifiConfigManager->getRSSI();
     doc["hotspot_active"] = wifiConfigManager->isHotspotActive();
     doc["hotspot_ssid"] = wifiConfigManager->getAPSSID();
     doc["cloud_enabled"] = cloudConfig.enabled;
-    doc["cloud_sync_in_progress"] = cloudSyncInProgress;
+    doc["cloud_sync_in_progress"] = cloudSyncInProgress.load();
     doc["timestamp"] = millis();
     
     if (wifiConfigManager->isWiFiConnected()) {
@@ -764,6 +1150,82 @@ void broadcastNetworkStatus() {
     webSocket.textAll(message);
 }
 
+// Cached WiFi scan results as returned by /scan_status and pushed on /ws
+void addScanResults(JsonDocument& doc) {
+    WiFiScanCache cache;
+    if (!networkManager->getScanResults(cache)) {
+        cache.count = 0;
+        cache.found = 0;
+        cache.completedAt = 0;
+    }
+    
+    if (networkManager->isScanInProgress()) {
+        doc["status"] = "scanning";
+        doc["message"] = "Scan in progress";
+    } else if (networkManager->didLastScanFail()) {
+        doc["status"] = "failed";
+        doc["message"] = "Scan failed";
+    } else if (cache.completedAt != 0) {
+        doc["status"] = "complete";
+        if (cache.found > cache.count) {
+            doc["message"] = "Showing strongest " + String(cache.count) + " of " + String(cache.found) + " networks found";
+        } else {
+            doc["message"] = "Found " + String(cache.found) + " networks";
+        }
+    } else {
+        doc["status"] = "idle";
+        doc["message"] = "No scan results yet";
+    }
+    
+    doc["count"] = cache.found;
+    doc["displayed"] = cache.count;
+    if (cache.completedAt != 0) {
+        doc["age_ms"] = millis() - cache.completedAt;
+    }
+    
+    JsonArray networks = doc["networks"].to<JsonArray>();
+    for (int i = 0; i < cache.count; i++) {
+        const ScanNetwork& scanned = cache.networks[i];
+        JsonObject network = networks.add<JsonObject>();
+        network["ssid"] = scanned.ssid;
+        network["rssi"] = scanned.rssi;
+        network["auth_mode"] = NetworkManager::getAuthModeName(scanned.authMode);
+        network["channel"] = scanned.channel;
+        
+        // Add signal strength indicator
+        String signalStrength = "Weak";
+        if (scanned.rssi >= -50) signalStrength = "Excellent";
+        else if (scanned.rssi >= -60) signalStrength = "Good";
+        else if (scanned.rssi >= -70) signalStrength = "Fair";
+        network["signal_strength"] = signalStrength;
+    }
+}
+
+// NetworkManager scan callback (loop context): push the new list to /ws
+void handleScanComplete(const WiFiScanCache& cache, bool failed) {
+    Serial.printf("📡 WiFi scan %s: %u networks, %u kept\n", failed ? "failed" : "complete",
+                  (unsigned)cache.found, (unsigned)cache.count);
+    if (webSocket.count() == 0) return;
+    
+    JsonDocument doc;
+    doc["type"] = "wifi_scan";
+    addScanResults(doc);
+    doc["timestamp"] = millis();
+    
+    String message;
+    serializeJson(doc, message);
+    webSocket.textAll(message);
+}
+
+// NetworkManager state callback (loop context): mirror the change straight
+// away so status endpoints and the network broadcast follow the radio
+void handleWiFiStateChange(WiFiState state, const String& ssid) {
+    Serial.printf("📶 WiFi %s: %s\n", NetworkManager::getWiFiStateName(state), ssid.c_str());
+    if (wifiConfigManager != nullptr) {
+        wifiConfigManager->checkWiFiStatus();
+    }
+}
+
 void broadcastDangerStatus() {
     if (webSocket.count() == 0) return;
     
@@ -791,19 +1253,19 @@ void broadcastDangerStatus() {
 // =============================================
 // HARDWARE FUNCTIONS
 // =============================================
-void updateStatusLED(const String& state) {
+void updateStatusLED(CPRState state) {
     static unsigned long lastLEDUpdate = 0;
     static bool ledState = false;
     unsigned long now = millis();
     
-    if (state == "compression") {
+    if (state == CPRState::Compression) {
         // Fast blinking during compression
         if (now - lastLEDUpdate > 100) {
             ledState = !ledState;
             digitalWrite(LED_PIN, ledState ? HIGH : LOW);
             lastLEDUpdate = now;
         }
-    } else if (state == "recoil") {
+    } else if (state == CPRState::Recoil) {
         // Solid on during recoil
         digitalWrite(LED_PIN, HIGH);
     } else {
@@ -812,30 +1274,23 @@ void updateStatusLED(const String& state) {
     }
 }
 
-void processAudioAlerts(const std::vector<String>& alerts) {
+void processAudioAlerts(const CPRAlerts& alerts) {
     if (alerts.empty() || isCurrentlyPlayingAudio) return;
     
     unsigned long now = millis();
     if (now - lastAudioEndTime < MIN_AUDIO_GAP) return;
     
-    // Play audio based on alert type
-    for (const String& alert : alerts) {
-        if (alert.indexOf("rate too low") != -1) {
-            playAlertAudio("rateTooLow");
-            break;
-        } else if (alert.indexOf("rate too high") != -1) {
-            playAlertAudio("rateTooHigh");
-            break;
-        } else if (alert.indexOf("Press harder") != -1) {
-            playAlertAudio("depthTooLow");
-            break;
-        } else if (alert.indexOf("Be gentle") != -1) {
-            playAlertAudio("depthTooHigh");
-            break;
-        } else if (alert.indexOf("Release more") != -1) {
-            playAlertAudio("incompleteRecoil");
-            break;
-        }
+    // Play audio based on alert type (rate first, then depth, then recoil)
+    if (alerts.has(CPRAlertCode::RateTooLow)) {
+        playAlertAudio("rateTooLow");
+    } else if (alerts.has(CPRAlertCode::RateTooHigh)) {
+        playAlertAudio("rateTooHigh");
+    } else if (alerts.has(CPRAlertCode::DepthTooLow)) {
+        playAlertAudio("depthTooLow");
+    } else if (alerts.has(CPRAlertCode::DepthTooHigh)) {
+        playAlertAudio("depthTooHigh");
+    } else if (alerts.has(CPRAlertCode::IncompleteRecoil)) {
+        playAlertAudio("incompleteRecoil");
     }
 }
 
@@ -967,12 +1422,12 @@ void checkSPIFFSHealth() {
                              usagePercent, SPIFFS_DANGER_THRESHOLD);
                 Serial.println("❌ All operations suspended - Cloud upload required");
                 
-                // Stop recording if active
+                // Stop recording if active (the metrics task owns the session)
                 if (isRecording) {
                     Serial.println("⏹️ Auto-stopping recording due to SPIFFS danger mode");
-                    dbManager->endCurrentSession();
-                    isRecording = false;
-                    closeCSVFile();
+                    ControlCommand command;
+                    command.type = ControlCommandType::StopRecording;
+                    queueControlCommand(command);
                 }
             } else if (spiffsDangerMode && usagePercent <= SPIFFS_SAFE_THRESHOLD) {
                 // Exiting danger mode (hysteresis prevents flickering)
@@ -1094,7 +1549,7 @@ void initializeCSVFile() {
     }
 }
 
-bool openCSVFile() {
+bool openCSVFile(int sessionId) {
     if (csvFileOpen) {
         Serial.println("CSV file already open");
         return true;
@@ -1108,12 +1563,13 @@ bool openCSVFile() {
     csvFile = SPIFFS.open(csvFileName, "a");
     if (csvFile) {
         csvFileOpen = true;
+        csvSessionId = sessionId;
         csvWriteCount = 0;
         Serial.printf("CSV file opened for writing: %s\n", csvFileName.c_str());
         
         // Write a session start marker
         unsigned long now = millis();
-        csvFile.printf("# Session %d started at %lu\n", currentSessionId, now);
+        csvFile.printf("# Session %d started at %lu\n", csvSessionId, now);
         csvFile.flush();
         
         return true;
@@ -1127,97 +1583,127 @@ void closeCSVFile() {
     if (csvFileOpen && csvFile) {
         // Write session end marker
         unsigned long now = millis();
-        csvFile.printf("# Session %d ended at %lu\n", currentSessionId, now);
+        csvFile.printf("# Session %d ended at %lu\n", csvSessionId, now);
         csvFile.flush();
         csvFile.close();
         csvFileOpen = false;
         csvWriteCount = 0;
         Serial.printf("CSV file closed: %s\n", csvFileName.c_str());
         
-        // Trigger cloud sync if enabled
+        // Trigger cloud sync if enabled; lastSyncTime belongs to the sync task,
+        // so queue a request instead of clearing it
         if (cloudConfig.enabled) {
             Serial.println("Triggering cloud sync after session end...");
-            cloudConfig.lastSyncTime = 0; // Force immediate sync
+            cloudSyncRequested = true;
+            if (cloudSyncTaskHandle != nullptr) {
+                xTaskNotifyGive(cloudSyncTaskHandle);
+            }
         }
     }
 }
 
-void writeCSVData(int sessionId, unsigned long timestamp, int rawValue, const CPRStatus& status) {
+// Metrics task: the CSV columns for one snapshot
+CsvRow makeCsvRow(unsigned long timestamp, int rawValue, int scaledValue, const CPRSnapshot& status) {
+    CsvRow row;
+    row.timestamp = timestamp;
+    row.rawValue = rawValue;
+    row.scaledValue = scaledValue;
+    row.state = status.state;
+    row.rate = status.currentRate;
+    row.ccf = status.ccf;
+    
+    // Determine quality based on state and values
+    if (row.state == CPRState::Compression) {
+        row.isGood = status.currentCompression.isGood;
+        row.compressionPeak = status.currentCompression.peakValue;
+    } else if (row.state == CPRState::Recoil) {
+        row.isGood = status.currentRecoil.isGood;
+        row.recoilMin = status.currentRecoil.minValue;
+    }
+    return row;
+}
+
+// Persistence task only
+void writeCSVData(int sessionId, const CsvRow& row) {
     if (!csvFileOpen || !csvFile) {
         Serial.println("WARNING: CSV file not open for writing");
         return;
     }
     
-    // Convert 12-bit ADC (0-4095) to 10-bit range (0-1023) for compatibility
-    int scaledValue = map(rawValue, 0, 4095, 0, 1023);
-    
-    // Get current state and quality from CPRStatus
-    String state = status.state;
-    bool isGood = false;
-    float compressionPeak = 0;
-    float recoilMin = 0;
-    
-    // Determine quality based on state and values
-    if (state == "compression") {
-        isGood = status.currentCompression.isGood;
-        compressionPeak = status.currentCompression.peakValue;
-    } else if (state == "recoil") {
-        isGood = status.currentRecoil.isGood;
-        recoilMin = status.currentRecoil.minValue;
-    }
-    
     // Write comprehensive CSV line
     csvFile.printf("%s,%d,%lu,%d,%d,%s,%s,%.2f,%.2f,%d,%.1f\n",
                    chipId.c_str(),
                    sessionId,
-                   timestamp,
-                   rawValue,
-                   scaledValue,
-                   state.c_str(),
-                   isGood ? "true" : "false",
-                   compressionPeak,
-                   recoilMin,
-                   status.currentRate,
-                   status.ccf);
-    
-    csvWriteCount++;
+                   row.timestamp,
+                   row.rawValue,
+                   row.scaledValue,
+                   cprStateToString(row.state),
+                   row.isGood ? "true" : "false",
+                   row.compressionPeak,
+                   row.recoilMin,
+                   row.rate,
+                   row.ccf);
+    
+    int written = ++csvWriteCount;
     
     // Flush periodically to ensure data is written
-    if (csvWriteCount % 20 == 0 || (millis() - lastCSVWrite) > 1000) {
+    unsigned long now = millis();
+    if (written % 20 == 0 || (now - lastCSVWrite) > 1000) {
         csvFile.flush();
     }
+    lastCSVWrite = now;
     
     // Debug output every 100 writes
-    if (csvWriteCount % 100 == 0) {
-        Serial.printf("CSV: Written %d records to %s\n", csvWriteCount, csvFileName.c_str());
+    if (written % 100 == 0) {
+        Serial.printf("CSV: Written %d records to %s\n", written, csvFileName.c_str());
     }
 }
 
-void handleCSVLogging(unsigned long currentTime, int potValue, const CPRStatus& status) {
+// Metrics task: queues at most one row per CSV_WRITE_INTERVAL for the persistence task
+void handleCSVLogging(unsigned long currentTime, int potValue, float scaledValue, const CPRSnapshot& status) {
     // Block CSV operations in danger mode
     if (spiffsDangerMode) {
         return; // Silently skip CSV logging
     }
     
-    if (isRecording && csvFileOpen && (currentTime - lastCSVWrite >= CSV_WRITE_INTERVAL)) {
-        writeCSVData(currentSessionId, currentTime, potValue, status);
-        lastCSVWrite = currentTime;
+    if (isRecording && (currentTime - lastCSVQueued >= CSV_WRITE_INTERVAL)) {
+        PersistRecord record;
+        record.type = PersistRecordType::Sample;
+        record.sessionId = currentSessionId;
+        record.row = makeCsvRow(currentTime, potValue, lroundf(scaledValue), status);
+        queuePersistRecord(record, 0);
+        lastCSVQueued = currentTime;
     }
 }
 
-bool deleteCSVFile() {
-    closeCSVFile();
+// Persistence task only. Never closes a session's file: a recording queued
+// ahead of the delete keeps it.
+CsvDeleteOutcome deleteCSVFile() {
+    if (csvFileOpen) {
+        Serial.printf("CSV file in use by a recording, not deleted: %s\n", csvFileName.c_str());
+        return CsvDeleteOutcome::InUse;
+    }
     if (SPIFFS.exists(csvFileName)) {
         if (SPIFFS.remove(csvFileName)) {
             Serial.printf("CSV file deleted: %s\n", csvFileName.c_str());
-            return true;
+            return CsvDeleteOutcome::Deleted;
         } else {
             Serial.printf("Failed to delete CSV file: %s\n", csvFileName.c_str());
-            return false;
+            return CsvDeleteOutcome::Failed;
         }
     }
     Serial.printf("CSV file does not exist: %s\n", csvFileName.c_str());
-    return true;
+    return CsvDeleteOutcome::Missing;
+}
+
+const char* csvDeleteOutcomeName(CsvDeleteOutcome outcome) {
+    switch (outcome) {
+        case CsvDeleteOutcome::Deleted: return "deleted";
+        case CsvDeleteOutcome::Missing: return "missing";
+        case CsvDeleteOutcome::InUse: return "in_use";
+        case CsvDeleteOutcome::Failed: return "failed";
+        default: return "none";
+    }
 }
 
 // =============================================
@@ -1230,13 +1716,19 @@ void initializeSessionTracking() {
     Serial.printf("Last session number: %d\n", lastSessionNumber);
 }
 
+// Metrics task: RAM only. The persistence task stores the number when it
+// opens the session, so no NVS write stalls the metrics task.
 int getNextSessionNumber() {
     lastSessionNumber++;
-    sessionPrefs.putInt("lastSession", lastSessionNumber);
     Serial.printf("Next session number: %d\n", lastSessionNumber);
     return lastSessionNumber;
 }
 
+// Persistence task only
+void saveSessionNumber(int sessionNumber) {
+    sessionPrefs.putInt("lastSession", sessionNumber);
+}
+
 void setupCSVSystem() {
     // Initialize chip ID first
     initializeChipId();
@@ -1256,28 +1748,218 @@ void setupCSVSystem() {
 // WEB SERVER SETUP WITH ALL ROUTES INCLUDING CLOUD ENDPOINTS
 // =============================================
 
-void setupWebServer() {
-    // WebSocket setup
-    webSocket.onEvent(onWebSocketEvent);
-    server.addHandler(&webSocket);
-    
-    animWebSocket.onEvent(onAnimWebSocketEvent);
-    server.addHandler(&animWebSocket);
-    
-    // Main pages
-    server.on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
-        request->send(SPIFFS, "/index.html", "text/html");
-    });
+// =============================================
+// STATUS PUBLICATION AND CONTROL COMMANDS
+// =============================================
+
+// Called from the metrics task only
+void publishState() {
+    PublishedState state;
+    state.status = metricsCalculator->getStatus();
+    state.summary = metricsCalculator->getSessionSummary();
+    state.isRecording = isRecording;
+    state.csvFileOpen = csvFileOpen;
+    state.spiffsDangerMode = spiffsDangerMode;
+    state.currentSessionId = currentSessionId;
+    state.lastSessionNumber = lastSessionNumber;
+    state.csvWriteCount = csvWriteCount;
+    state.sampleIntervalMicros = metricsCalculator->getSampleIntervalMicros();
+    state.decimationFactor = metricsCalculator->getDecimationFactor();
+    state.sampleCyclesAvg = sampleCyclesAvg;
+    state.sampleCyclesMax = sampleCyclesMax;
+    state.lastCommandId = lastAppliedCommandId;
+    
+    publishedState.write(state);
+    lastStatusPublish = millis();
+}
+
+// Safe from any task. SeqLock::read() leaves a partial copy when it gives up,
+// so a failed read returns the last snapshot any reader got in one piece
+PublishedState readPublishedState() {
+    static PublishedState lastGood;
+    static SemaphoreHandle_t lastGoodMutex = xSemaphoreCreateMutex();
     
-    server.on("/config", HTTP_GET, [](AsyncWebServerRequest *request) {
-        request->send(SPIFFS, "/config.html", "text/html");
-    });
+    PublishedState state;
+    bool consistent = publishedState.read(state);
     
-    // WiFi Configuration Page
-    server.on("/ssid_config", HTTP_GET, [](AsyncWebServerRequest *request) {
-        Serial.println("📱 Serving WiFi config page");
-        if (SPIFFS.exists("/ssid_config.html")) {
-            request->send(SPIFFS, "/ssid_config.html", "text/html");
+    xSemaphoreTake(lastGoodMutex, portMAX_DELAY);
+    if (consistent) {
+        lastGood = state;
+    } else {
+        state = lastGood;
+    }
+    xSemaphoreGive(lastGoodMutex);
+    return state;
+}
+
+// Queues a command for the metrics task; returns its id, or 0 if the queue is full
+uint32_t queueControlCommand(ControlCommand& command) {
+    command.id = nextCommandId.fetch_add(1);
+    if (controlQueue == nullptr || xQueueSend(controlQueue, &command, 0) != pdTRUE) {
+        return 0;
+    }
+    return command.id;
+}
+
+const char* controlCommandName(ControlCommandType type) {
+    switch (type) {
+        case ControlCommandType::ToggleRecording: return "toggle_recording";
+        case ControlCommandType::StopRecording: return "stop_recording";
+        case ControlCommandType::UpdateParams: return "update_params";
+    }
+    return "unknown";
+}
+
+// loop() only: tells /ws clients a queued command has taken effect
+void broadcastCommandApplied(uint32_t id, ControlCommandType type, bool recording, int sessionId) {
+    if (webSocket.count() == 0) return;
+    
+    JsonDocument doc;
+    doc["type"] = "command_applied";
+    doc["command_id"] = id;
+    doc["command"] = controlCommandName(type);
+    doc["is_recording"] = recording;
+    doc["session_id"] = sessionId;
+    
+    String message;
+    serializeJson(doc, message);
+    webSocket.textAll(message);
+}
+
+// loop() only
+void broadcastRecordingStatus(bool recording, int sessionId) {
+    if (webSocket.count() > 0) {
+        JsonDocument wsDoc;
+        wsDoc["type"] = "recording_status";
+        wsDoc["is_recording"] = recording;
+        wsDoc["session_id"] = sessionId;
+        wsDoc["cloud_enabled"] = cloudConfig.enabled;
+        wsDoc["message"] = recording ? ("Session " + String(sessionId) + " started") : 
+                                     ("Session " + String(sessionId) + " stopped");
+        
+        String wsMessage;
+        serializeJson(wsDoc, wsMessage);
+        webSocket.textAll(wsMessage);
+    }
+    
+    if (!recording && animWebSocket.count() > 0) {
+        broadcastAnimationState("quietude");
+    }
+}
+
+// Metrics task only; the persistence task opens and closes the session's files
+void toggleRecording() {
+    PersistRecord record;
+    if (!isRecording) {
+        if (spiffsDangerMode) {
+            Serial.println("⚠️ Start ignored - SPIFFS danger mode active");
+            return;
+        }
+        
+        currentSessionId = getNextSessionNumber();
+        metricsCalculator->reset();
+        isRecording = true;
+        
+        record.type = PersistRecordType::SessionStart;
+        record.sessionId = currentSessionId;
+        if (!queuePersistRecord(record, SESSION_RECORD_WAIT)) {
+            Serial.println("Warning: persistence queue full - session not opened");
+        }
+        
+        Serial.printf("Training session %d started - metrics reset\n", currentSessionId);
+    } else {
+        record.type = PersistRecordType::SessionEnd;
+        record.sessionId = currentSessionId;
+        record.summary = metricsCalculator->getSessionSummary();
+        if (!queuePersistRecord(record, SESSION_RECORD_WAIT)) {
+            Serial.println("Warning: persistence queue full - session not closed");
+        }
+        isRecording = false;
+        
+        Serial.printf("Training session %d stopped\n", currentSessionId);
+    }
+    
+    UiEvent event;
+    event.type = UiEventType::RecordingChanged;
+    event.recording = isRecording;
+    event.sessionId = currentSessionId;
+    queueUiEvent(event);
+}
+
+// Drains the command queue; called by the metrics task between sample batches
+void applyControlCommands() {
+    if (controlQueue == nullptr) {
+        return;
+    }
+    
+    ControlCommand command;
+    bool applied = false;
+    while (xQueueReceive(controlQueue, &command, 0) == pdTRUE) {
+        switch (command.type) {
+            case ControlCommandType::ToggleRecording:
+                toggleRecording();
+                break;
+            case ControlCommandType::StopRecording:
+                if (isRecording) {
+                    toggleRecording();
+                }
+                break;
+            case ControlCommandType::UpdateParams:
+                metricsCalculator->updateParams(command.params);
+                adcSampler.setSampleRate(1000000UL / metricsCalculator->getSampleIntervalMicros());
+                Serial.println("Configuration updated via web interface");
+                break;
+        }
+        lastAppliedCommandId = command.id;
+        applied = true;
+        
+        UiEvent event;
+        event.type = UiEventType::CommandApplied;
+        event.commandId = command.id;
+        event.command = command.type;
+        event.recording = isRecording;
+        event.sessionId = currentSessionId;
+        queueUiEvent(event);
+    }
+    
+    if (applied) {
+        publishState();
+    }
+}
+
+void addStageStats(JsonObject stage, const StageMonitor& monitor, size_t capacity) {
+    StageMonitor::Snapshot stats = monitor.read();
+    stage["items"] = stats.items;
+    stage["drops"] = stats.drops;
+    stage["latency_avg_us"] = stats.latencyAvgMicros;
+    stage["latency_max_us"] = stats.latencyMaxMicros;
+    stage["queue_depth"] = stats.queueDepth;
+    stage["queue_depth_max"] = stats.queueDepthMax;
+    stage["queue_capacity"] = capacity;
+}
+
+void setupWebServer() {
+    // WebSocket setup
+    webSocket.onEvent(onWebSocketEvent);
+    server.addHandler(&webSocket);
+    
+    animWebSocket.onEvent(onAnimWebSocketEvent);
+    server.addHandler(&animWebSocket);
+    
+    // Main pages
+    server.on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
+        request->send(SPIFFS, "/index.html", "text/html");
+    });
+    
+    server.on("/config", HTTP_GET, [](AsyncWebServerRequest *request) {
+        request->send(SPIFFS, "/config.html", "text/html");
+    });
+    
+    // WiFi Configuration Page
+    server.on("/ssid_config", HTTP_GET, [](AsyncWebServerRequest *request) {
+        Serial.println("📱 Serving WiFi config page");
+        if (SPIFFS.exists("/ssid_config.html")) {
+            request->send(SPIFFS, "/ssid_config.html", "text/html");
         } else {
             request->send(404, "text/plain", "WiFi config page not found in SPIFFS");
         }
@@ -1310,7 +1992,7 @@ void setupWebServer() {
         doc["enabled"] = cloudConfig.enabled;
         doc["last_sync"] = cloudConfig.lastSyncTime;
         doc["synced_sessions"] = cloudConfig.syncedSessions;
-        doc["sync_in_progress"] = cloudSyncInProgress;
+        doc["sync_in_progress"] = cloudSyncInProgress.load();
         
         // Don't send sensitive credentials
         //doc["has_access_key"] = !cloudConfig.accessKey.isEmpty();
@@ -1383,6 +2065,7 @@ void setupWebServer() {
                 }
                 
                 // Update cloud configuration
+                xSemaphoreTake(cloudConfigMutex, portMAX_DELAY);
                 cloudConfig.provider = provider;
                 cloudConfig.accessKey = accessKey;
                 cloudConfig.secretKey = secretKey;
@@ -1390,6 +2073,7 @@ void setupWebServer() {
                 cloudConfig.endpointUrl = endpoint;
                 cloudConfig.syncFrequency = frequency;
                 cloudConfig.enabled = true;
+                xSemaphoreGive(cloudConfigMutex);
                 
                 // Save to preferences
                 saveCloudConfig();
@@ -1435,44 +2119,43 @@ void setupWebServer() {
                     response["success"] = false;
                     response["error"] = "Invalid JSON";
                 } else {
-                    // Temporarily save test config
-                    CloudConfig originalConfig = cloudConfig;
+                    CloudConfig testConfig = CloudConfig();
+                    testConfig.provider = doc["provider"] | "";
+                    testConfig.accessKey = doc["access_key"] | "";
+                    testConfig.secretKey = doc["secret_key"] | "";
+                    testConfig.bucketName = doc["bucket"] | "";
+                    testConfig.endpointUrl = doc["endpoint"] | "";
                     
-                    cloudConfig.provider = doc["provider"] | "";
-                    cloudConfig.accessKey = doc["access_key"] | "";
-                    cloudConfig.secretKey = doc["secret_key"] | "";
-                    cloudConfig.bucketName = doc["bucket"] | "";
-                    cloudConfig.endpointUrl = doc["endpoint"] | "";
-                    
-                    if (cloudConfig.provider.isEmpty() || cloudConfig.accessKey.isEmpty() || 
-                        cloudConfig.secretKey.isEmpty() || cloudConfig.bucketName.isEmpty()) {
+                    uint8_t idle = (uint8_t)CloudTestState::Idle;
+                    if (testConfig.provider.isEmpty() || testConfig.accessKey.isEmpty() || 
+                        testConfig.secretKey.isEmpty() || testConfig.bucketName.isEmpty()) {
                         response["success"] = false;
                         response["error"] = "Missing required fields for test";
                     } else if (!wifiConfigManager->isWiFiConnected()) {
                         response["success"] = false;
                         response["error"] = "WiFi not connected";
+                    } else if (cloudSyncTaskHandle == nullptr ||
+                               !cloudTestState.compare_exchange_strong(idle, (uint8_t)CloudTestState::Claimed)) {
+                        response["success"] = false;
+                        response["error"] = "A connection test is already running";
                     } else {
-                        // Test the connection
-                        bool testResult = testCloudConnection();
+                        // The sync task runs the test; the handler never waits for it
+                        cloudTestConfig = testConfig;
+                        cloudTestResult = (uint8_t)CloudTestResult::None;
+                        cloudTestState = (uint8_t)CloudTestState::Queued;
+                        xTaskNotifyGive(cloudSyncTaskHandle);
                         
-                        if (testResult) {
-                            response["success"] = true;
-                            response["message"] = "Cloud connection test successful";
-                            response["provider"] = cloudConfig.provider;
-                            response["bucket"] = cloudConfig.bucketName;
-                        } else {
-                            response["success"] = false;
-                            response["error"] = "Failed to connect to cloud storage. Check credentials and network connection.";
-                        }
+                        response["success"] = true;
+                        response["status"] = "queued";
+                        response["message"] = "Connection test started - result in /cloud_sync_status";
+                        response["provider"] = testConfig.provider;
+                        response["bucket"] = testConfig.bucketName;
                     }
-                    
-                    // Restore original config
-                    cloudConfig = originalConfig;
                 }
                 
                 String responseStr;
                 serializeJson(response, responseStr);
-                request->send(200, "application/json", responseStr);
+                request->send(response["status"] == "queued" ? 202 : 200, "application/json", responseStr);
             }
         }
     );
@@ -1493,12 +2176,19 @@ void setupWebServer() {
             response["success"] = false;
             response["error"] = "WiFi not connected";
         } else {
-            // Force immediate sync
-            cloudConfig.lastSyncTime = 0;
-            performCloudSync();
+            // The sync task picks this up; the handler never waits for the upload
+            cloudSyncRequested = true;
+            if (cloudSyncTaskHandle) {
+                xTaskNotifyGive(cloudSyncTaskHandle);
+            }
             
             response["success"] = true;
-            response["message"] = "Cloud sync initiated";
+            if (cloudUpload.pauseRequested) {
+                response["message"] = "Cloud sync queued - starts when resumed";
+            } else {
+                response["message"] = isRecording ? "Cloud sync queued - starts when recording stops"
+                                                  : "Cloud sync initiated";
+            }
         }
         
         String responseStr;
@@ -1510,13 +2200,26 @@ void setupWebServer() {
     server.on("/cloud_sync_status", HTTP_GET, [](AsyncWebServerRequest *request) {
         JsonDocument doc;
         doc["enabled"] = cloudConfig.enabled;
-        doc["sync_in_progress"] = cloudSyncInProgress;
+        doc["sync_in_progress"] = cloudSyncInProgress.load();
         doc["last_sync_time"] = cloudConfig.lastSyncTime;
         doc["synced_sessions"] = cloudConfig.syncedSessions;
         doc["provider"] = cloudConfig.provider;
         doc["bucket"] = cloudConfig.bucketName;
         doc["frequency_minutes"] = cloudConfig.syncFrequency;
         
+        // Progress of the upload in flight (or of the last one)
+        uint32_t bytesSent = cloudUpload.bytesSent;
+        uint32_t bytesTotal = cloudUpload.bytesTotal;
+        doc["paused"] = cloudUpload.pauseRequested.load();
+        doc["waiting_for_recording"] = cloudSyncRequested && isRecording;
+        doc["bytes_sent"] = bytesSent;
+        doc["bytes_total"] = bytesTotal;
+        doc["progress_percent"] = bytesTotal > 0 ? (100.0f * bytesSent / bytesTotal) : 0.0f;
+        doc["last_result"] = cloudSyncOutcomeName((CloudSyncOutcome)cloudSyncLastOutcome.load());
+        doc["pending_upload"] = SPIFFS.exists(CLOUD_PENDING_FILE);
+        doc["test_in_progress"] = cloudTestState.load() != (uint8_t)CloudTestState::Idle;
+        doc["last_test_result"] = cloudTestResultName((CloudTestResult)cloudTestResult.load());
+        
         if (cloudConfig.lastSyncTime > 0) {
             doc["time_since_last_sync"] = millis() - cloudConfig.lastSyncTime;
             doc["next_sync_in"] = (cloudConfig.syncFrequency * 60000UL) - (millis() - cloudConfig.lastSyncTime);
@@ -1533,6 +2236,8 @@ void setupWebServer() {
         
         cloudConfig.enabled = false;
         saveCloudConfig();
+        cloudSyncRequested = false;
+        cloudUpload.cancelRequested = true;   // Stops an upload in progress
         
         JsonDocument response;
         response["success"] = true;
@@ -1543,6 +2248,38 @@ void setupWebServer() {
         request->send(200, "application/json", responseStr);
     });
 
+    // Upload control; a pause stops the upload in flight at the next payload
+    // chunk and holds off new ones until resumed
+    server.on("/pause_cloud_sync", HTTP_POST, [](AsyncWebServerRequest *request) {
+        cloudUpload.pauseRequested = true;
+        request->send(200, "application/json", "{\"success\":true,\"message\":\"Cloud sync paused\"}");
+    });
+    
+    server.on("/resume_cloud_sync", HTTP_POST, [](AsyncWebServerRequest *request) {
+        cloudUpload.pauseRequested = false;
+        if (cloudSyncTaskHandle != nullptr) {
+            xTaskNotifyGive(cloudSyncTaskHandle);   // Pick up an interrupted upload now
+        }
+        request->send(200, "application/json", "{\"success\":true,\"message\":\"Cloud sync resumed\"}");
+    });
+    
+    server.on("/cancel_cloud_sync", HTTP_POST, [](AsyncWebServerRequest *request) {
+        JsonDocument response;
+        if (cloudSyncInProgress) {
+            cloudUpload.cancelRequested = true;
+            response["success"] = true;
+            response["message"] = "Cloud sync cancelling";
+        } else {
+            cloudSyncRequested = false;
+            response["success"] = false;
+            response["error"] = "No cloud sync in progress";
+        }
+        
+        String responseStr;
+        serializeJson(response, responseStr);
+        request->send(200, "application/json", responseStr);
+    });
+
     // Get current WiFi configuration
     server.on("/get_wifi_config", HTTP_GET, [](AsyncWebServerRequest *request) {
         Preferences prefs;
@@ -1559,165 +2296,35 @@ void setupWebServer() {
         serializeJson(doc, response);
         request->send(200, "application/json", response);
     });
-    // WiFi scan endpoint with async handling and timeout protection
+    // WiFi scan endpoint: starts a background scan and returns the cached
+    // results at once; fresh results follow on /ws ("wifi_scan") and /scan_status
     server.on("/scan_networks", HTTP_POST, [](AsyncWebServerRequest *request) {
         Serial.println("🔍 WiFi scan request received");
         
-        // Check if a scan is already in progress
-        static bool scanInProgress = false;
-        static unsigned long scanStartTime = 0;
-        const unsigned long SCAN_TIMEOUT = 15000; // 15 seconds timeout
-        
-        if (scanInProgress) {
-            // Check if scan has timed out
-            if (millis() - scanStartTime > SCAN_TIMEOUT) {
-                Serial.println("⚠️ WiFi scan timeout, resetting...");
-                WiFi.scanDelete();
-                scanInProgress = false;
-            } else {
-                JsonDocument doc;
-                doc["success"] = false;
-                doc["error"] = "Scan already in progress, please wait";
-                doc["count"] = 0;
-                
-                String response;
-                serializeJson(doc, response);
-                request->send(429, "application/json", response); // 429 = Too Many Requests
-                return;
-            }
-        }
-        
-        // Start async scan
-        scanInProgress = true;
-        scanStartTime = millis();
-        
-        Serial.println("🔄 Starting WiFi network scan...");
-        
-        // Use async scan with callback
-        WiFi.scanNetworks(true, false, false, 300); // async=true, show_hidden=false, passive=false, max_ms_per_chan=300
-        
-        // Wait briefly for quick networks to appear
-        unsigned long waitStart = millis();
-        while (WiFi.scanComplete() == WIFI_SCAN_RUNNING && (millis() - waitStart) < 3000) {
-            delay(100);
-            yield();
-        }
-        
-        int16_t scanResult = WiFi.scanComplete();
+        bool alreadyRunning = networkManager->isScanInProgress();
+        bool started = !alreadyRunning && networkManager->startScan();
+        bool success = started || alreadyRunning;
         
         JsonDocument doc;
-        
-        if (scanResult == WIFI_SCAN_RUNNING) {
-            // Still running after brief wait
-            doc["success"] = false;
-            doc["error"] = "Scan timeout - try again in a moment";
-            doc["count"] = 0;
-            doc["message"] = "WiFi scan is taking longer than expected";
-            
-            scanInProgress = false;
-            WiFi.scanDelete();
-            
-        } else if (scanResult == WIFI_SCAN_FAILED || scanResult < 0) {
-            // Scan failed
-            doc["success"] = false;
-            doc["error"] = "WiFi scan failed";
-            doc["count"] = 0;
-            doc["message"] = "Unable to scan for networks at this time";
-            
-            scanInProgress = false;
-            WiFi.scanDelete();
-            
+        addScanResults(doc);
+        doc["success"] = success;
+        if (started) {
+            doc["message"] = "Scan started - results will be pushed when complete";
+        } else if (alreadyRunning) {
+            doc["message"] = "Scan already in progress";
         } else {
-            // Scan completed successfully
-            JsonArray networks = doc["networks"].to<JsonArray>();
-            
-            int networkCount = scanResult;
-            
-            if (networkCount > 0) {
-                // Limit to maximum 20 networks to prevent large responses
-                int maxNetworks = min(networkCount, 20);
-                
-                for (int i = 0; i < maxNetworks; i++) {
-                    JsonObject network = networks.add<JsonObject>();
-                    network["ssid"] = WiFi.SSID(i);
-                    network["rssi"] = WiFi.RSSI(i);
-                    
-                    // Convert encryption type to readable format
-                    wifi_auth_mode_t authType = WiFi.encryptionType(i);
-                    String authString = "Unknown";
-                    switch(authType) {
-                        case WIFI_AUTH_OPEN: authString = "Open"; break;
-                        case WIFI_AUTH_WEP: authString = "WEP"; break;
-                        case WIFI_AUTH_WPA_PSK: authString = "WPA"; break;
-                        case WIFI_AUTH_WPA2_PSK: authString = "WPA2"; break;
-                        case WIFI_AUTH_WPA_WPA2_PSK: authString = "WPA/WPA2"; break;
-                        case WIFI_AUTH_WPA2_ENTERPRISE: authString = "WPA2-Enterprise"; break;
-                        case WIFI_AUTH_WPA3_PSK: authString = "WPA3"; break;
-                        case WIFI_AUTH_WPA2_WPA3_PSK: authString = "WPA2/WPA3"; break;
-                        default: authString = "Encrypted"; break;
-                    }
-                    
-                    network["auth_mode"] = authString;
-                    network["channel"] = WiFi.channel(i);
-                    
-                    // Add signal strength indicator
-                    int rssi = WiFi.RSSI(i);
-                    String signalStrength = "Weak";
-                    if (rssi >= -50) signalStrength = "Excellent";
-                    else if (rssi >= -60) signalStrength = "Good";
-                    else if (rssi >= -70) signalStrength = "Fair";
-                    
-                    network["signal_strength"] = signalStrength;
-                }
-                
-                doc["success"] = true;
-                doc["count"] = networkCount;
-                doc["displayed"] = maxNetworks;
-                
-                if (networkCount > 20) {
-                    doc["message"] = "Showing first 20 of " + String(networkCount) + " networks found";
-                } else {
-                    doc["message"] = "Found " + String(networkCount) + " networks";
-                }
-                
-                Serial.println("📡 Found " + String(networkCount) + " networks, displaying " + String(maxNetworks));
-            } else {
-                doc["success"] = true;
-                doc["count"] = 0;
-                doc["message"] = "No networks found";
-                
-                Serial.println("📡 No networks found");
-            }
-            
-            scanInProgress = false;
-            WiFi.scanDelete(); // Clean up scan results
+            doc["error"] = "Unable to scan for networks at this time";
         }
         
         String response;
         serializeJson(doc, response);
-        request->send(200, "application/json", response);
+        request->send(success ? 202 : 503, "application/json", response);
     });
     
-    // WiFi scan status endpoint for checking ongoing scans
+    // Cached results of the last scan, and whether one is running
     server.on("/scan_status", HTTP_GET, [](AsyncWebServerRequest *request) {
         JsonDocument doc;
-        
-        int16_t scanResult = WiFi.scanComplete();
-        
-        if (scanResult == WIFI_SCAN_RUNNING) {
-            doc["status"] = "scanning";
-            doc["message"] = "Scan in progress";
-        } else if (scanResult == WIFI_SCAN_FAILED) {
-            doc["status"] = "failed";
-            doc["message"] = "Scan failed";
-        } else if (scanResult >= 0) {
-            doc["status"] = "complete";
-            doc["count"] = scanResult;
-            doc["message"] = "Scan complete";
-        } else {
-            doc["status"] = "idle";
-            doc["message"] = "No scan running";
-        }
+        addScanResults(doc);
         
         String response;
         serializeJson(doc, response);
@@ -1737,14 +2344,27 @@ void setupWebServer() {
     });
     
     // Internet connectivity status endpoint
+    // Reports the cached probe result; ?refresh=1 asks for a fresh probe,
+    // whose result shows up on a later poll
     server.on("/internet_status", HTTP_GET, [](AsyncWebServerRequest *request) {
-        networkManager->checkInternetConnectivity();
+        if (request->hasParam("refresh")) {
+            networkManager->requestInternetProbe();
+        }
         
         JsonDocument status;
         status["internet_connected"] = networkManager->isInternetConnected();
+        status["probe_url"] = networkManager->getProbeUrl();
+        status["probe_in_flight"] = networkManager->isProbeInFlight();
+        status["probe_http_code"] = networkManager->getLastProbeCode();
+        status["probe_latency_ms"] = networkManager->getLastProbeLatency();
+        status["probe_failures"] = networkManager->getProbeFailures();
+        status["next_probe_in_ms"] = networkManager->getNextProbeIn();
+        if (networkManager->getLastProbeTime() != 0) {
+            status["last_probe_ms_ago"] = millis() - networkManager->getLastProbeTime();
+        }
         status["wifi_connected"] = wifiConfigManager->isWiFiConnected();
         status["cloud_enabled"] = cloudConfig.enabled;
-        status["cloud_sync_in_progress"] = cloudSyncInProgress;
+        status["cloud_sync_in_progress"] = cloudSyncInProgress.load();
         status["timestamp"] = millis();
         
         if (wifiConfigManager->isWiFiConnected()) {
@@ -1759,7 +2379,7 @@ void setupWebServer() {
     });
     // Configuration API
     server.on("/get_config", HTTP_GET, [](AsyncWebServerRequest *request) {
-        CPRThresholds params = metricsCalculator->getParams();
+        CPRThresholds params = readPublishedState().status.thresholds;
         
         JsonDocument doc;
         doc["status"] = "success";
@@ -1774,6 +2394,14 @@ void setupWebServer() {
         config["quiet_threshold"] = params.quietThreshold;
         config["smoothing_window"] = params.smoothingWindow;
         config["rate_smoothing_factor"] = params.rateSmoothingFactor;
+        config["averaging_window"] = params.averagingWindow;
+        config["rate_window"] = params.rateWindow;
+        config["sample_rate_hz"] = params.sampleRateHz;
+        config["filter_cutoff_hz"] = params.filterCutoffHz;
+        config["filter_sections"] = params.filterSections;
+        config["detector_mode"] = params.detectorMode == CPRDetectorMode::ZeroCrossing ? "zero_crossing" : "slope";
+        config["peak_prominence"] = params.peakProminence;
+        config["rate_source"] = params.rateSource == CPRRateSource::Autocorrelation ? "autocorrelation" : "onsets";
         
         String response;
         serializeJson(doc, response);
@@ -1813,11 +2441,59 @@ void setupWebServer() {
                     newParams.quietThreshold = doc["quiet_threshold"] | 2.0;
                     newParams.smoothingWindow = doc["smoothing_window"] | 3;
                     newParams.rateSmoothingFactor = doc["rate_smoothing_factor"] | 0.3;
+                    newParams.averagingWindow = doc["averaging_window"] | 100;
+                    newParams.rateWindow = doc["rate_window"] | 9;
+                    newParams.sampleRateHz = doc["sample_rate_hz"] | 40;
+                    newParams.filterCutoffHz = doc["filter_cutoff_hz"] | 0.0;
+                    newParams.filterSections = doc["filter_sections"] | 2;
+                    newParams.detectorMode = (String(doc["detector_mode"] | "slope") == "zero_crossing") ?
+                        CPRDetectorMode::ZeroCrossing : CPRDetectorMode::Slope;
+                    newParams.peakProminence = doc["peak_prominence"] | 30.0;
+                    newParams.rateSource = (String(doc["rate_source"] | "onsets") == "autocorrelation") ?
+                        CPRRateSource::Autocorrelation : CPRRateSource::Onsets;
                     
-                    metricsCalculator->updateParams(newParams);
+                    // The calculator's windows have fixed storage; clamp here so
+                    // the reply and /get_config show the values that take effect
+                    CPRThresholds requested = newParams;
+                    newParams = CPRMetricsCalculator::clampParams(requested);
                     
-                    request->send(200, "application/json", "{\"status\":\"success\",\"message\":\"Configuration updated\"}");
-                    Serial.println("Configuration updated via web interface");
+                    // Applied by the metrics task between sample batches; the
+                    // handler does not wait. Completion is a "command_applied"
+                    // /ws message, or last_command_id in /status
+                    ControlCommand command;
+                    command.type = ControlCommandType::UpdateParams;
+                    command.params = newParams;
+                    uint32_t id = queueControlCommand(command);
+                    
+                    if (id == 0) {
+                        request->send(503, "application/json", "{\"error\":\"Command queue full, try again\"}");
+                    } else {
+                        JsonDocument response;
+                        response["status"] = "queued";
+                        response["message"] = "Configuration update queued";
+                        response["command_id"] = id;
+                        
+                        JsonObject adjusted = response["adjusted"].to<JsonObject>();
+                        if (newParams.smoothingWindow != requested.smoothingWindow) {
+                            adjusted["smoothing_window"] = newParams.smoothingWindow;
+                        }
+                        if (newParams.averagingWindow != requested.averagingWindow) {
+                            adjusted["averaging_window"] = newParams.averagingWindow;
+                        }
+                        if (newParams.rateWindow != requested.rateWindow) {
+                            adjusted["rate_window"] = newParams.rateWindow;
+                        }
+                        if (newParams.sampleRateHz != requested.sampleRateHz) {
+                            adjusted["sample_rate_hz"] = newParams.sampleRateHz;
+                        }
+                        if (newParams.filterSections != requested.filterSections) {
+                            adjusted["filter_sections"] = newParams.filterSections;
+                        }
+                        
+                        String responseStr;
+                        serializeJson(response, responseStr);
+                        request->send(202, "application/json", responseStr);
+                    }
                     
                 } catch (...) {
                     request->send(500, "application/json", "{\"error\":\"Failed to update configuration\"}");
@@ -1866,7 +2542,7 @@ void setupWebServer() {
                 JsonDocument response;
                 response["success"] = result;
                 if (result) {
-                    response["message"] = "WiFi configuration saved and connection initiated";
+                    response["message"] = "Connection test started - configuration is saved once it connects";
                 } else {
                     response["error"] = "Failed to save configuration";
                 }
@@ -1882,13 +2558,17 @@ void setupWebServer() {
     server.on("/network_status", HTTP_GET, [](AsyncWebServerRequest *request) {
         JsonDocument status;
         status["wifi_connected"] = wifiConfigManager->isWiFiConnected();
+        status["wifi_state"] = NetworkManager::getWiFiStateName(networkManager->getWiFiState());
+        status["wifi_reconnect_attempts"] = networkManager->getReconnectAttempts();
+        status["wifi_retry_in_ms"] = networkManager->getRetryIn();
+        status["wifi_disconnect_reason"] = networkManager->getLastDisconnectReason();
         status["wifi_ssid"] = wifiConfigManager->getSSID();
         status["wifi_rssi"] = wifiConfigManager->getRSSI();
         status["ip_address"] = wifiConfigManager->getLocalIP().toString();
         status["hotspot_active"] = wifiConfigManager->isHotspotActive();
         status["hotspot_ssid"] = wifiConfigManager->getAPSSID();
         status["cloud_enabled"] = cloudConfig.enabled;
-        status["cloud_sync_in_progress"] = cloudSyncInProgress;
+        status["cloud_sync_in_progress"] = cloudSyncInProgress.load();
         status["timestamp"] = millis();
         
         String response;
@@ -1915,7 +2595,7 @@ void setupWebServer() {
         doc["csv_file_exists"] = SPIFFS.exists(csvFileName);
         doc["csv_file_name"] = csvFileName;
         doc["chip_id"] = chipId;
-        doc["next_session"] = lastSessionNumber + 1;
+        doc["next_session"] = readPublishedState().lastSessionNumber + 1;
         doc["cloud_enabled"] = cloudConfig.enabled;
         doc["cloud_provider"] = cloudConfig.provider;
         
@@ -1932,20 +2612,56 @@ void setupWebServer() {
         }
     });
     
+    // The persistence task owns the CSV file; it deletes it in queue order,
+    // after any session start or upload rotation queued before
     server.on("/delete_csv", HTTP_POST, [](AsyncWebServerRequest *request) {
         JsonDocument response;
+        int code = 200;
         
-        if (isRecording) {
+        PersistRecord record;
+        record.type = PersistRecordType::DeleteCsv;
+        if (readPublishedState().isRecording) {
             response["success"] = false;
             response["error"] = "Cannot delete CSV file while recording is active";
+        } else if (!queuePersistRecord(record, 0)) {
+            code = 503;
+            response["success"] = false;
+            response["error"] = "Persistence queue full, try again";
         } else {
-            bool result = deleteCSVFile();
-            response["success"] = result;
-            if (result) {
-                response["message"] = "CSV file deleted successfully";
-            } else {
-                response["error"] = "Failed to delete CSV file";
-            }
+            code = 202;
+            response["success"] = true;
+            response["status"] = "queued";
+            response["message"] = "CSV delete queued - result in /status (csv_delete_result)";
+        }
+        
+        String responseStr;
+        serializeJson(response, responseStr);
+        request->send(code, "application/json", responseStr);
+    });
+    
+    // Re-score a recorded CSV with the current thresholds (faster than real time)
+    server.on("/replay_session", HTTP_POST, [](AsyncWebServerRequest *request) {
+        JsonDocument response;
+        String fileName = request->hasParam("file", true) ? request->getParam("file", true)->value() : csvFileName;
+        
+        if (readPublishedState().isRecording) {
+            response["success"] = false;
+            response["error"] = "Cannot replay while recording is active";
+        } else if (replayTaskHandle == nullptr) {
+            response["success"] = false;
+            response["error"] = "Replay task not running";
+        } else if (!SPIFFS.exists(fileName)) {
+            response["success"] = false;
+            response["error"] = "CSV file not found";
+        } else if (replayBusy.exchange(true)) {
+            response["success"] = false;
+            response["error"] = "Replay already in progress";
+        } else {
+            replayFileName = fileName;
+            xTaskNotifyGive(replayTaskHandle);
+            response["success"] = true;
+            response["message"] = "Replay queued";
+            response["file"] = fileName;
         }
         
         String responseStr;
@@ -1953,22 +2669,112 @@ void setupWebServer() {
         request->send(200, "application/json", responseStr);
     });
     
+    server.on("/replay_status", HTTP_GET, [](AsyncWebServerRequest *request) {
+        JsonDocument doc;
+        doc["in_progress"] = replayBusy.load();
+        doc["file"] = replayFileName;
+        
+        // Busy means a replay is rewriting the results; report them next time
+        if (replayResultsMutex != nullptr && xSemaphoreTake(replayResultsMutex, 0) == pdTRUE) {
+            if (replayHasResults) {
+                const ReplayStats& stats = sessionReplayer->getStats();
+                doc["lines"] = stats.lines;
+                doc["samples"] = stats.samples;
+                doc["interpolated_samples"] = stats.interpolated;
+                doc["malformed"] = stats.malformed;
+                doc["sessions_seen"] = stats.sessions;
+                doc["elapsed_us"] = stats.elapsedMicros;
+                doc["samples_per_second"] = stats.samplesPerSecond;
+                doc["speedup"] = stats.speedup;
+                doc["note"] = "CSV rows are rate-limited; gaps are interpolated to the feature rate, so metrics approximate the live run";
+            
+                JsonArray sessions = doc["sessions"].to<JsonArray>();
+                for (size_t i = 0; i < sessionReplayer->getSessionCount(); i++) {
+                    const ReplaySessionResult& result = sessionReplayer->getSession(i);
+                    JsonObject obj = sessions.add<JsonObject>();
+                    obj["session_id"] = result.sessionId;
+                    obj["rows"] = result.rows;
+                    obj["samples"] = result.samples;
+                    obj["interpolated_samples"] = result.interpolated;
+                    obj["row_rate_hz"] = result.rowRateHz;
+                    obj["duration_ms"] = result.lastTimestamp - result.firstTimestamp;
+                    obj["state_mismatches"] = result.stateMismatches;
+                    obj["good_compressions"] = result.compressions.good;
+                    obj["total_compressions"] = result.compressions.total;
+                    obj["good_recoils"] = result.recoils.goodRecoil;
+                    obj["total_recoils"] = result.recoils.total;
+                    obj["rate"] = result.rate;
+                    obj["ccf"] = result.ccf;
+                    obj["cycles"] = result.cycles;
+                    obj["rate_p50"] = result.summary.rate.p50;
+                    obj["depth_avg"] = result.summary.depth.mean;
+                    obj["depth_p10"] = result.summary.depth.p10;
+                    obj["depth_p50"] = result.summary.depth.p50;
+                    obj["depth_p90"] = result.summary.depth.p90;
+                    obj["recoil_p90"] = result.summary.recoil.p90;
+                }
+            }
+            xSemaphoreGive(replayResultsMutex);
+        }
+        
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+    
     // Status endpoint - Enhanced with cloud info
     server.on("/status", HTTP_GET, [](AsyncWebServerRequest *request) {
+        PublishedState state = readPublishedState();
+        
         JsonDocument status;
         status["status"] = "running";
         status["chip_id"] = chipId;
-        status["recording"] = isRecording;
-        status["session_id"] = currentSessionId;
-        status["next_session"] = lastSessionNumber + 1;
+        status["recording"] = state.isRecording;
+        status["session_id"] = state.currentSessionId;
+        status["next_session"] = state.lastSessionNumber + 1;
         status["metrics_clients"] = webSocket.count();
         status["anim_clients"] = animWebSocket.count();
         status["free_heap"] = ESP.getFreeHeap();
-        status["csv_file_open"] = csvFileOpen;
+        status["csv_file_open"] = state.csvFileOpen;
         status["csv_file_name"] = csvFileName;
         status["csv_file_exists"] = SPIFFS.exists(csvFileName);
-        status["csv_write_count"] = csvWriteCount;
-        
+        status["csv_write_count"] = state.csvWriteCount;
+        status["csv_delete_result"] = csvDeleteOutcomeName((CsvDeleteOutcome)csvDeleteLastOutcome.load());
+        status["sample_interval_us"] = state.sampleIntervalMicros;
+        status["decimation_factor"] = state.decimationFactor;
+        status["sample_cycles_avg"] = state.sampleCyclesAvg;
+        status["sample_cycles_max"] = state.sampleCyclesMax;
+        status["last_command_id"] = state.lastCommandId;
+        
+        // Acquisition counters are atomics owned by the sampler task
+        AdcSamplerStats acquisitionStats = adcSampler.getStats();
+        JsonObject acquisition = status["acquisition"].to<JsonObject>();
+        acquisition["mode"] = acquisitionModeName();
+        acquisition["rate_hz"] = acquisitionStats.sampleRateHz;
+        acquisition["measured_rate_hz"] = acquisitionStats.measuredRateHz;
+        acquisition["oversample"] = acquisitionStats.oversample;
+        acquisition["calibration"] = adcCalibration.getSourceName();
+        acquisition["samples"] = acquisitionStats.samples;
+        acquisition["queued"] = acquisitionStats.queued;
+        acquisition["ring_overflows"] = acquisitionStats.ringOverflows;
+        acquisition["dma_overruns"] = acquisitionStats.dmaOverruns;
+        acquisition["read_errors"] = acquisitionStats.readErrors;
+        SampleTimingMonitor::Snapshot timing = adcSampler.getTiming();
+        acquisition["missed_deadlines"] = timing.missedDeadlines;
+        acquisition["mean_jitter_us"] = timing.meanAbsJitterMicros;
+
+        // Whole-session distributions (streaming percentiles)
+        const CPRSessionSummary& summary = state.summary;
+        JsonObject session = status["session_stats"].to<JsonObject>();
+        session["depth_p10"] = summary.depth.p10;
+        session["depth_p50"] = summary.depth.p50;
+        session["depth_p90"] = summary.depth.p90;
+        session["recoil_p50"] = summary.recoil.p50;
+        session["recoil_p90"] = summary.recoil.p90;
+        session["rate_p10"] = summary.rate.p10;
+        session["rate_p50"] = summary.rate.p50;
+        session["rate_p90"] = summary.rate.p90;
+
         // WiFi status information
         status["wifi_connected"] = wifiConfigManager->isWiFiConnected();
         status["wifi_ssid"] = wifiConfigManager->getSSID();
@@ -1981,7 +2787,7 @@ void setupWebServer() {
         status["cloud_provider"] = cloudConfig.provider;
         status["cloud_bucket"] = cloudConfig.bucketName;
         status["cloud_sync_frequency"] = cloudConfig.syncFrequency;
-        status["cloud_sync_in_progress"] = cloudSyncInProgress;
+        status["cloud_sync_in_progress"] = cloudSyncInProgress.load();
         status["cloud_last_sync"] = cloudConfig.lastSyncTime;
         status["cloud_synced_sessions"] = cloudConfig.syncedSessions;
         
@@ -1998,69 +2804,112 @@ void setupWebServer() {
         request->send(200, "application/json", response);
     });
 
+    // Sample clock telemetry: interval deviation histogram and missed deadlines
+    server.on("/sample_timing", HTTP_GET, [](AsyncWebServerRequest *request) {
+        AdcSamplerStats acquisitionStats = adcSampler.getStats();
+        SampleTimingMonitor::Snapshot timing = adcSampler.getTiming();
+        
+        JsonDocument doc;
+        doc["mode"] = acquisitionModeName();
+        doc["period_us"] = timing.periodMicros;
+        doc["rate_hz"] = acquisitionStats.sampleRateHz;
+        doc["measured_rate_hz"] = acquisitionStats.measuredRateHz;
+        doc["intervals"] = timing.intervals;
+        doc["missed_deadlines"] = timing.missedDeadlines;
+        doc["min_interval_us"] = timing.minIntervalMicros;
+        doc["max_interval_us"] = timing.maxIntervalMicros;
+        doc["mean_abs_jitter_us"] = timing.meanAbsJitterMicros;
+        
+        // Bin i counts deviations below edges[i] (and at or above edges[i-1]);
+        // the last bin is open-ended
+        const int32_t* edges = SampleTimingMonitor::binEdges();
+        JsonArray edgeArray = doc["bin_edges_us"].to<JsonArray>();
+        for (size_t i = 0; i < SampleTimingMonitor::BIN_COUNT - 1; i++) {
+            edgeArray.add(edges[i]);
+        }
+        JsonArray binArray = doc["bins"].to<JsonArray>();
+        for (size_t i = 0; i < SampleTimingMonitor::BIN_COUNT; i++) {
+            binArray.add(timing.bins[i]);
+        }
+        
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+    
+    server.on("/sample_timing_reset", HTTP_POST, [](AsyncWebServerRequest *request) {
+        adcSampler.resetTiming();
+        request->send(200, "application/json", "{\"success\":true}");
+    });
+
+    // Per-stage throughput, drops, queue depth and latency
+    server.on("/pipeline", HTTP_GET, [](AsyncWebServerRequest *request) {
+        AdcSamplerStats acquisitionStats = adcSampler.getStats();
+        
+        JsonDocument doc;
+        JsonObject acquisition = doc["acquisition"].to<JsonObject>();
+        acquisition["mode"] = acquisitionModeName();
+        acquisition["items"] = acquisitionStats.samples;
+        acquisition["drops"] = acquisitionStats.ringOverflows;
+        acquisition["queue_depth"] = acquisitionStats.queued;
+        acquisition["queue_capacity"] = (size_t)AdcSampler::RING_SIZE;
+        
+        addStageStats(doc["metrics"].to<JsonObject>(), metricsStage, AdcSampler::RING_SIZE);
+        addStageStats(doc["persistence"].to<JsonObject>(), persistStage, PERSIST_QUEUE_LENGTH);
+        addStageStats(doc["ui"].to<JsonObject>(), uiStage, UI_QUEUE_LENGTH);
+        
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+    
+    server.on("/pipeline_reset", HTTP_POST, [](AsyncWebServerRequest *request) {
+        metricsStage.resetPeaks();
+        persistStage.resetPeaks();
+        uiStage.resetPeaks();
+        request->send(200, "application/json", "{\"success\":true}");
+    });
+
     // Recording control
     server.on("/start_stop", HTTP_POST, [](AsyncWebServerRequest *request) {
         JsonDocument response;
-            if (spiffsDangerMode && !isRecording) {
-        response["status"] = "blocked";
-        response["error"] = "Operations suspended - SPIFFS storage full. Enable cloud upload.";
-        response["spiffs_danger"] = true;
-        response["is_recording"] = false;
+        PublishedState state = readPublishedState();
         
-        String responseStr;
-        serializeJson(response, responseStr);
-        request->send(423, "application/json", responseStr); // 423 = Locked
-        return;
-    }
-        if (!isRecording) {
-            currentSessionId = getNextSessionNumber();
-            metricsCalculator->reset();
-            dbManager->startNewSession();
-            isRecording = true;
-            
-            if (!openCSVFile()) {
-                Serial.println("Warning: Failed to open CSV file for recording");
-            }
-            
-            response["status"] = "started";
-            response["session_id"] = currentSessionId;
-            response["is_recording"] = true;
-            
-            Serial.printf("Training session %d started - metrics reset\n", currentSessionId);
-        } else {
-            dbManager->endCurrentSession();
-            isRecording = false;
-            closeCSVFile(); // This will trigger cloud sync if enabled
-            
-            response["status"] = "stopped";
-            response["session_id"] = currentSessionId;
+        if (state.spiffsDangerMode && !state.isRecording) {
+            response["status"] = "blocked";
+            response["error"] = "Operations suspended - SPIFFS storage full. Enable cloud upload.";
+            response["spiffs_danger"] = true;
             response["is_recording"] = false;
             
-            Serial.printf("Training session %d stopped\n", currentSessionId);
+            String responseStr;
+            serializeJson(response, responseStr);
+            request->send(423, "application/json", responseStr); // 423 = Locked
+            return;
         }
         
-        String responseStr;
-        serializeJson(response, responseStr);
-        request->send(200, "application/json", responseStr);
-        
-        // Broadcast to WebSockets
-        if (webSocket.count() > 0) {
-            JsonDocument wsDoc;
-            wsDoc["type"] = "recording_status";
-            wsDoc["is_recording"] = isRecording;
-            wsDoc["session_id"] = currentSessionId;
-            wsDoc["cloud_enabled"] = cloudConfig.enabled;
-            wsDoc["message"] = isRecording ? ("Session " + String(currentSessionId) + " started") : 
-                                           ("Session " + String(currentSessionId) + " stopped");
-            
-            String wsMessage;
-            serializeJson(wsDoc, wsMessage);
-            webSocket.textAll(wsMessage);
+        // Session start/stop runs on the metrics task, which owns the calculator
+        // and the recording flags; the persistence task opens and closes the
+        // session files. The handler does not wait: the outcome arrives as
+        // "recording_status" and "command_applied" on /ws, and in /status
+        ControlCommand command;
+        command.type = ControlCommandType::ToggleRecording;
+        uint32_t id = queueControlCommand(command);
+        
+        int code = 202;
+        if (id == 0) {
+            code = 503;
+            response["status"] = "busy";
+            response["error"] = "Command queue full, try again";
+            response["is_recording"] = state.isRecording;
+        } else {
+            response["status"] = "queued";
+            response["command_id"] = id;
+            response["is_recording"] = !state.isRecording;   // Expected once applied
         }
         
-        if (!isRecording && animWebSocket.count() > 0) {
-            broadcastAnimationState("quietude");
-        }
+        String responseStr;
+        serializeJson(response, responseStr);
+        request->send(code, "application/json", responseStr);
     });
     // Debug endpoint - Enhanced with cloud info
     server.on("/debug", HTTP_GET, [](AsyncWebServerRequest *request) {
@@ -2113,13 +2962,14 @@ void setupWebServer() {
         
         debug += "<h2>CSV Status</h2>";
         debug += "CSV File Exists: " + String(SPIFFS.exists(csvFileName) ? "Yes" : "No") + "<br>";
-        debug += "CSV File Open: " + String(csvFileOpen ? "Yes" : "No") + "<br>";
-        debug += "CSV Write Count: " + String(csvWriteCount) + "<br>";
+        PublishedState state = readPublishedState();
+        debug += "CSV File Open: " + String(state.csvFileOpen ? "Yes" : "No") + "<br>";
+        debug += "CSV Write Count: " + String(state.csvWriteCount) + "<br>";
         
         debug += "<h2>Recording Status</h2>";
-        debug += "Recording: " + String(isRecording ? "Yes" : "No") + "<br>";
-        debug += "Current Session: " + String(currentSessionId) + "<br>";
-        debug += "Next Session: " + String(lastSessionNumber + 1) + "<br>";
+        debug += "Recording: " + String(state.isRecording ? "Yes" : "No") + "<br>";
+        debug += "Current Session: " + String(state.currentSessionId) + "<br>";
+        debug += "Next Session: " + String(state.lastSessionNumber + 1) + "<br>";
         
         debug += "<h2>WebSocket Status</h2>";
         debug += "Metrics WS Clients: " + String(webSocket.count()) + "<br>";
@@ -2213,11 +3063,14 @@ void setupWebServer() {
     Serial.println("  /ssid_config - WiFi Configuration Page");
     Serial.println("  /cloud_config - Cloud Configuration Page");
     Serial.println("  /network_status - Network status API");
-    Serial.println("  /scan_networks - WiFi scan API");
+    Serial.println("  /scan_networks - WiFi scan API (results pushed on /ws)");
+    Serial.println("  /scan_status - Cached WiFi scan results");
     Serial.println("  /internet_status - Internet connectivity status");
     Serial.println("  /config - CPR Configuration");
     Serial.println("  /data - Data Management");
     Serial.println("  /debug - Debug Information");
+    Serial.println("  /sample_timing - Sample clock jitter and missed deadlines");
+    Serial.println("  /pipeline - Per-stage queue depth and latency");
     Serial.println("  CLOUD ENDPOINTS:");
     Serial.println("    /get_cloud_config - Get cloud settings");
     Serial.println("    /save_cloud_config - Save cloud settings");
@@ -2225,77 +3078,284 @@ void setupWebServer() {
     Serial.println("    /trigger_cloud_sync - Manual cloud sync");
     Serial.println("    /cloud_sync_status - Cloud sync status");
     Serial.println("    /disable_cloud_sync - Disable cloud sync");
+    Serial.println("    /pause_cloud_sync, /resume_cloud_sync, /cancel_cloud_sync - Upload control");
 }
 // =============================================
 // MAIN LOOP WITH ENHANCED CLOUD SYNC MONITORING
 // =============================================
 
-void loop() {
-    unsigned long currentTime = millis();
+// Metrics task: one calibrated ADC sample through the calculator, feeding
+// the persistence and UI stages
+void processPotSample(uint16_t adcCode, unsigned long sampleTime) {
+    unsigned long now = millis();
     
-    // Update WiFi Configuration Manager
-    wifiConfigManager->loop();
+    // Oversampled 12.4 fixed-point ADC code to the calculator's 0-1023 range
+    float scaledValue = adcCalibration.toUnits(adcCode);
+    
+    // Process through metrics calculator; in high-rate mode only every
+    // decimated sample produces a snapshot for the consumers below
+    CPRSnapshot status;
+    uint32_t cycleStart = ESP.getCycleCount();
+    bool featureSample = metricsCalculator->detectTrendHighRate(scaledValue, sampleTime, status);
+    uint32_t cycles = ESP.getCycleCount() - cycleStart;
+    sampleCyclesAvg = sampleCyclesAvg - (sampleCyclesAvg >> 6) + (cycles >> 6); // ~64-sample EMA
+    sampleCyclesMax = max(sampleCyclesMax, cycles);
     
-    // Perform periodic cloud sync if enabled
-    if (cloudConfig.enabled && !isRecording) {
-        performCloudSync();
+    if (!featureSample) {
+        return;
     }
-    if (spiffsDangerMode) {
-        broadcastDangerStatus();
+    
+    // Enhanced CSV logging with full status information
+    if (isRecording) {
+        handleCSVLogging(sampleTime, AdcCalibration::toRawCode(adcCode), scaledValue, status);
     }
-
-    // Read potentiometer at 40Hz
-    if (!spiffsDangerMode) {
-        if (currentTime - lastPotRead >= POT_READ_INTERVAL) {
-        int potValue = analogRead(POTENTIOMETER_PIN);
-        
-        // Convert 12-bit ADC (0-4095) to 10-bit range (0-1023) for metrics calculator
-        int scaledValue = map(potValue, 0, 4095, 0, 1023);
-        
-        // Process through metrics calculator
-        CPRStatus status = metricsCalculator->detectTrend(scaledValue);
-        
-        // Enhanced CSV logging with full status information
+    
+    // One record per completed compression cycle, drained every
+    // feature sample so the calculator's queue never overflows
+    CPRCompressionEvent compression;
+    while (metricsCalculator->popCompressionEvent(compression)) {
         if (isRecording) {
-            handleCSVLogging(currentTime, potValue, status);
+            PersistRecord record;
+            record.type = PersistRecordType::Compression;
+            record.sessionId = currentSessionId;
+            record.compression = compression;
+            queuePersistRecord(record, 0);
         }
-        
-        // Record to database if recording
-        if (isRecording && dbManager && (currentTime % 100 == 0)) {
-            dbManager->recordCompressionEvent(
-                currentTime,
-                scaledValue,
-                status.state.c_str(),
-                status.currentCompression.isGood
-            );
+        UiEvent event;
+        event.type = UiEventType::Compression;
+        event.compression = compression;
+        queueUiEvent(event);
+    }
+    
+    // LED and animation follow state changes; alerts are forwarded at most
+    // every ANIM_SEND_INTERVAL while they are raised
+    bool alertDue = !status.alerts.empty() && (now - lastAlertQueued >= ANIM_SEND_INTERVAL);
+    if (status.state != lastQueuedUiState || alertDue) {
+        UiEvent event;
+        event.type = UiEventType::StateUpdate;
+        event.state = status.state;
+        event.alerts = status.alerts;
+        event.recording = isRecording;
+        if (queueUiEvent(event)) {
+            lastQueuedUiState = status.state;
+            if (alertDue) {
+                lastAlertQueued = now;
+            }
         }
-        
-        lastPotRead = currentTime;
-        
-        // Send animation data at 20Hz
-        if (currentTime - lastAnimSend >= ANIM_SEND_INTERVAL) {
-            if (status.state != lastAnimState && animWebSocket.count() > 0) {
-                broadcastAnimationState(status.state);
-                lastAnimSend = currentTime;
+    }
+}
+
+// Metrics stage: owns metricsCalculator, applies web commands and publishes
+// the handlers' snapshot. Pinned next to acquisition, above loop(), so
+// network and SPIFFS stalls no longer hold up the calculator.
+void metricsTask(void* arg) {
+    for (;;) {
+        applyControlCommands();
+        
+        // Drain the acquisition ring; samples keep their ADC timestamps however
+        // late they are processed. Poll the ADC if the acquisition task failed.
+        if (adcSampler.isRunning()) {
+            if (spiffsDangerMode) {
+                adcSampler.discard();
+            } else {
+                AdcSample sample;
+                while (adcSampler.pop(sample)) {
+                    processPotSample(sample.code, (unsigned long)(sample.timestampMicros / 1000));
+                    metricsStage.record((uint32_t)(esp_timer_get_time() - sample.timestampMicros),
+                                        adcSampler.queued());
+                }
+            }
+        } else if (!spiffsDangerMode) {
+            unsigned long nowMicros = micros();
+            if (nowMicros - lastPotReadMicros >= metricsCalculator->getSampleIntervalMicros()) {
+                lastPotReadMicros = nowMicros;
+                processPotSample(AdcSampler::readOversampled(POTENTIOMETER_PIN), millis());
+                metricsStage.record(micros() - nowMicros, 0);
             }
         }
         
-        // Send metrics data at 2Hz
-        if (currentTime - lastDataSend >= DATA_SEND_INTERVAL) {
-            if (webSocket.count() > 0) {
-                broadcastStateUpdate(status);
-                lastDataSend = currentTime;
+        // Publish the snapshot the web handlers read
+        if (millis() - lastStatusPublish >= STATUS_PUBLISH_INTERVAL) {
+            publishState();
+        }
+        
+        vTaskDelay(adcSampler.isRunning() ? METRICS_TASK_PERIOD : 1);
+    }
+}
+
+// Persistence task only: owns the CSV file and dbManager
+void handlePersistRecord(const PersistRecord& record) {
+    switch (record.type) {
+        case PersistRecordType::SessionStart:
+            saveSessionNumber(record.sessionId);
+            dbManager->startNewSession();
+            if (!openCSVFile(record.sessionId)) {
+                Serial.println("Warning: Failed to open CSV file for recording");
             }
+            break;
+        case PersistRecordType::SessionEnd:
+            dbManager->endCurrentSession(record.summary);
+            closeCSVFile(); // This will trigger cloud sync if enabled
+            break;
+        case PersistRecordType::Sample:
+            if (csvFileOpen) {
+                writeCSVData(record.sessionId, record.row);
+            }
+            break;
+        case PersistRecordType::Compression:
+            dbManager->recordCompressionEvent(record.compression);
+            break;
+        case PersistRecordType::RotateForUpload:
+            // Only between sessions; a session that started meanwhile keeps the file
+            if (!csvFileOpen && !SPIFFS.exists(CLOUD_PENDING_FILE) &&
+                SPIFFS.rename(csvFileName, CLOUD_PENDING_FILE)) {
+                initializeCSVFile();
+            }
+            xSemaphoreGive(csvRotated);
+            break;
+        case PersistRecordType::DeleteCsv:
+            csvDeleteLastOutcome = (uint8_t)deleteCSVFile();
+            break;
+    }
+}
+
+// Persistence stage: every SPIFFS write happens here, on the core the
+// sampling path does not use
+void persistenceTask(void* arg) {
+    PersistRecord record;
+    for (;;) {
+        if (xQueueReceive(persistQueue, &record, PERSIST_IDLE_WAIT) == pdTRUE) {
+            handlePersistRecord(record);
+            persistStage.record(micros() - record.queuedMicros, uxQueueMessagesWaiting(persistQueue));
+        }
+        checkSPIFFSHealth();
+    }
+}
+
+// loop() only: the UI stage. Drains events from the metrics task, then
+// drives the LED and the throttled WebSocket streams.
+void serviceUiEvents() {
+    UiEvent event;
+    while (uiQueue != nullptr && xQueueReceive(uiQueue, &event, 0) == pdTRUE) {
+        switch (event.type) {
+            case UiEventType::StateUpdate:
+                uiState = event.state;
+                if (event.recording) {
+                    processAudioAlerts(event.alerts);
+                }
+                break;
+            case UiEventType::Compression:
+                broadcastCompressionEvent(event.compression);
+                break;
+            case UiEventType::RecordingChanged:
+                broadcastRecordingStatus(event.recording, event.sessionId);
+                break;
+            case UiEventType::CommandApplied:
+                broadcastCommandApplied(event.commandId, event.command, event.recording, event.sessionId);
+                break;
+        }
+        uiStage.record(micros() - event.queuedMicros, uxQueueMessagesWaiting(uiQueue));
+    }
+    
+    unsigned long now = millis();
+    
+    // Send animation data at 20Hz
+    if (now - lastAnimSend >= ANIM_SEND_INTERVAL) {
+        const char* animState = cprStateToString(uiState);
+        if (lastAnimState != animState && animWebSocket.count() > 0) {
+            broadcastAnimationState(animState);
+            lastAnimSend = now;
         }
+    }
+    
+    // Send metrics data at 2Hz
+    if (now - lastDataSend >= DATA_SEND_INTERVAL) {
+        if (webSocket.count() > 0) {
+            broadcastStateUpdate(readPublishedState().status);
+            lastDataSend = now;
+        }
+    }
+    
+    updateStatusLED(uiState);
+}
+
+void startPipeline() {
+    persistQueue = xQueueCreate(PERSIST_QUEUE_LENGTH, sizeof(PersistRecord));
+    uiQueue = xQueueCreate(UI_QUEUE_LENGTH, sizeof(UiEvent));
+    if (persistQueue == nullptr || uiQueue == nullptr) {
+        Serial.println("❌ Pipeline queues could not be allocated");
+    }
+    
+    if (xTaskCreatePinnedToCore(persistenceTask, "persistence", PERSIST_TASK_STACK, nullptr,
+                                PERSIST_TASK_PRIORITY, nullptr, PERSIST_TASK_CORE) != pdPASS) {
+        Serial.println("❌ Failed to start the persistence task");
+    }
+    if (xTaskCreatePinnedToCore(metricsTask, "metrics", METRICS_TASK_STACK, nullptr,
+                                METRICS_TASK_PRIORITY, nullptr, METRICS_TASK_CORE) != pdPASS) {
+        Serial.println("❌ Failed to start the metrics task");
+    }
+    
+    Serial.printf("🧵 Pipeline: metrics on core %d (priority %u), persistence on core %d (priority %u)\n",
+                  METRICS_TASK_CORE, (unsigned)METRICS_TASK_PRIORITY,
+                  PERSIST_TASK_CORE, (unsigned)PERSIST_TASK_PRIORITY);
+}
+
+// Replays run here, woken by /replay_session, so a long file never stalls
+// the UI stage in loop()
+void replayTask(void* arg) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
         
-        // Update LED and audio
-        updateStatusLED(status.state);
+        PublishedState state = readPublishedState();
+        if (state.isRecording) {
+            Serial.println("⏸️ Replay skipped - a recording started");
+            replayBusy = false;
+            continue;
+        }
+        String fileName = replayFileName;
         
-        if (isRecording) {
-            processAudioAlerts(status.alerts);
+        xSemaphoreTake(replayResultsMutex, portMAX_DELAY);
+        replayHasResults = false;
+        if (!sessionReplayer) {
+            sessionReplayer = new SessionReplayer();
         }
+        sessionReplayer->setParams(state.status.thresholds);
+        
+        Serial.printf("🔁 Replaying %s...\n", fileName.c_str());
+        bool replayed = sessionReplayer->replayFile(SPIFFS, fileName.c_str());
+        const ReplayStats& stats = sessionReplayer->getStats();
+        Serial.printf("🔁 Replay done: %u samples (%u interpolated), %u sessions in %lu us (%.0f samples/s, %.0fx real time)\n",
+                      (unsigned)stats.samples, (unsigned)stats.interpolated, (unsigned)stats.sessions,
+                      stats.elapsedMicros, stats.samplesPerSecond, stats.speedup);
+        replayHasResults = replayed;
+        xSemaphoreGive(replayResultsMutex);
+        replayBusy = false;
     }
+}
+
+void startReplayWorker() {
+    replayResultsMutex = xSemaphoreCreateMutex();
+    if (replayResultsMutex == nullptr ||
+        xTaskCreatePinnedToCore(replayTask, "replay", REPLAY_TASK_STACK, nullptr,
+                                REPLAY_TASK_PRIORITY, &replayTaskHandle, REPLAY_TASK_CORE) != pdPASS) {
+        Serial.println("❌ Failed to start the replay task");
+    }
+}
+
+void loop() {
+    unsigned long currentTime = millis();
+    
+    // UI stage: WebSocket streams, LED and audio from the metrics task's events
+    serviceUiEvents();
+    
+    // Advance the WiFi connection state machine, then mirror it
+    networkManager->handleTasks();
+    wifiConfigManager->loop();
+    
+    if (spiffsDangerMode) {
+        broadcastDangerStatus();
     }
+
     // Network monitoring and broadcasting - Enhanced with cloud status
     static unsigned long lastNetworkBroadcast = 0;
     static bool lastInternetStatus = false;
@@ -2331,7 +3391,7 @@ void loop() {
         
         // Debug CSV status
         if (isRecording && csvFileOpen) {
-            Serial.printf("CSV Status: %d records written to %s\n", csvWriteCount, csvFileName.c_str());
+            Serial.printf("CSV Status: %d records written to %s\n", csvWriteCount.load(), csvFileName.c_str());
         }
         
         // Debug cloud sync status
@@ -2353,9 +3413,6 @@ void loop() {
         isCurrentlyPlayingAudio = false;
     }
     
-    // SPIFFS health check
-    checkSPIFFSHealth();
-    
     yield();
 }
 
@@ -2373,6 +3430,7 @@ void setup() {
     pinMode(LED_PIN, OUTPUT);
     pinMode(AUDIO_PIN, OUTPUT);
     analogReadResolution(12); // 0-4095 range
+    adcCalibration.begin();   // ADC code -> 0-1023 lookup table
     
     // Set CPU frequency for performance
     setCpuFrequencyMhz(240);
@@ -2394,6 +3452,9 @@ void setup() {
     metricsCalculator = new CPRMetricsCalculator();
     dbManager = new DatabaseManager();
     networkManager = new NetworkManager();
+    networkManager->onWiFiStateChange(handleWiFiStateChange);
+    networkManager->onScanComplete(handleScanComplete);
+    networkManager->beginInternetProbe();
     
     // Initialize WiFi Configuration Manager
     wifiConfigManager = new WiFiConfigManager(&server);
@@ -2401,14 +3462,18 @@ void setup() {
     // Initialize WiFi Configuration Manager
     wifiConfigManager->begin();
 
-    // Give WiFi time to connect if credentials exist
-    delay(5000);
+    // Give WiFi up to 5 s to connect if credentials exist; stops waiting as
+    // soon as the first attempt completes, later retries run from loop()
+    unsigned long wifiWaitStart = millis();
+    networkManager->handleTasks(); // Applies the connect request posted above
+    while (networkManager->getWiFiState() == WiFiState::Connecting && millis() - wifiWaitStart < 5000) {
+        delay(50);
+        networkManager->handleTasks();
+    }
     
-    // Check if WiFi connected and update NetworkManager
+    // Check if WiFi connected
     if (wifiConfigManager->isWiFiConnected()) {
         Serial.println("✅ WiFi connection established during setup");
-        // Force NetworkManager to recognize the connection
-        networkManager->handleTasks();
         
         // Wait for time sync if WiFi is connected
         Serial.println("⏰ Waiting for time synchronization...");
@@ -2427,6 +3492,26 @@ void setup() {
         Serial.println("ℹ️ No WiFi connection established during setup");
     }
     
+    // Start acquisition at the calculator's input rate
+    int acquisitionRate = 1000000UL / metricsCalculator->getSampleIntervalMicros();
+    if (!adcSampler.begin(POTENTIOMETER_PIN, acquisitionRate, PREFERRED_ACQUISITION_MODE)) {
+        if (PREFERRED_ACQUISITION_MODE == AcquisitionMode::Dma &&
+            adcSampler.begin(POTENTIOMETER_PIN, acquisitionRate, AcquisitionMode::Timer)) {
+            Serial.println("⚠️ DMA acquisition unavailable - using the hardware timer");
+        } else {
+            Serial.println("⚠️ Acquisition task unavailable - polling the ADC from the metrics task");
+        }
+    }
+    
+    // Handlers talk to the metrics task through the command queue and published state
+    controlQueue = xQueueCreate(CONTROL_QUEUE_LENGTH, sizeof(ControlCommand));
+    publishState();
+    
+    // Metrics and persistence tasks; loop() keeps the UI and network work
+    startPipeline();
+    startCloudSyncWorker();
+    startReplayWorker();
+    
     // Start web server
     setupWebServer();
     
@@ -2498,6 +3583,9 @@ void setup() {
     // Perform initial cloud sync if enabled and WiFi connected
     if (cloudConfig.enabled && wifiConfigManager->isWiFiConnected()) {
         Serial.println("☁️ Performing initial cloud sync check...");
-        cloudConfig.lastSyncTime = 0; // Force initial sync check
+        cloudSyncRequested = true;   // The sync task is already running
+        if (cloudSyncTaskHandle != nullptr) {
+            xTaskNotifyGive(cloudSyncTaskHandle);
+        }
     }
 }
\ No newline at end of file